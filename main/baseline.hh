@@ -0,0 +1,167 @@
+// Copyright: 2020, Diez B. Roggisch, Berlin, all rights reserved
+#pragma once
+
+#include <nvs.h>
+#include <esp_log.h>
+
+#include <math.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <array>
+#include <algorithm>
+
+// The spectrum of a normal grind, learned from the frames
+// while grinding, and a score of how far each frame deviates
+// from it. A rising score hints at burr wear.
+//
+// The baseline is a running mean of the dB values with a
+// time constant of TIME_CONSTANT frames, starting out as a
+// plain mean so the first grinds count fully. The score is
+// the mean absolute difference in dB, O(bins) per frame.
+//
+// The baseline survives reboots in NVS, keyed by the bin
+// range. It is only written by save(), which is meant to be
+// called once per grind, so the flash doesn't wear out.
+template<int SIZE>
+class BaselineSpectrum
+{
+  static constexpr const char* NVS_NAMESPACE = "coffee-clock";
+  static constexpr uint32_t TIME_CONSTANT = 1024;
+  // frames needed until the score means something
+  static constexpr uint32_t MIN_FRAMES = 64;
+
+  struct stored_t
+  {
+    uint32_t size;
+    uint32_t first_bin;
+    // in mHz, so it compares exactly
+    uint32_t samplerate;
+    uint32_t frames;
+    std::array<float, SIZE> values;
+  };
+
+public:
+  // The samplerate the spectra are taken at, a baseline
+  // stored for another one doesn't apply.
+  BaselineSpectrum(float samplerate)
+    : _samplerate(uint32_t(samplerate * 1000.0f))
+  {
+    start(0, 0);
+  }
+
+  // Scores the dB values [begin, end) of a frame, which
+  // start at first_bin of the spectrum, while grinding,
+  // and learns them into the baseline.
+  //
+  // Each FFT size and bin range has a baseline of its own,
+  // so switching between them keeps what was learned.
+  template<typename T>
+  void update(T begin, T end, size_t first_bin)
+  {
+    const auto size = std::min(size_t(end - begin), size_t(SIZE));
+    auto& baseline = _stored.values;
+    if(size != _stored.size || first_bin != _stored.first_bin)
+    {
+      save();
+      load(size, first_bin);
+    }
+    if(_stored.frames >= MIN_FRAMES)
+    {
+      float distance = 0.0;
+      for(size_t i=0; i < size; ++i)
+      {
+        distance += fabsf(begin[i] - baseline[i]);
+      }
+      _score = distance / size;
+    }
+    _stored.frames = std::min(_stored.frames + 1, TIME_CONSTANT);
+    const auto alpha = 1.0f / _stored.frames;
+    for(size_t i=0; i < size; ++i)
+    {
+      baseline[i] += alpha * (begin[i] - baseline[i]);
+    }
+    _dirty = true;
+  }
+
+  // Only valid once enough frames were learned.
+  bool valid() const
+  {
+    return _stored.frames >= MIN_FRAMES;
+  }
+
+  // The mean deviation of the last frame in dB
+  float score() const
+  {
+    return _score;
+  }
+
+  // Writes the baseline if it changed since the last call.
+  void save()
+  {
+    if(!_dirty)
+    {
+      return;
+    }
+    nvs_handle_t handle;
+    if(nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK)
+    {
+      return;
+    }
+    const auto length = offsetof(stored_t, values) + _stored.size * sizeof(float);
+    if(nvs_set_blob(handle, key().data(), &_stored, length) == ESP_OK
+       && nvs_commit(handle) == ESP_OK)
+    {
+      _dirty = false;
+    }
+    nvs_close(handle);
+  }
+
+private:
+  void start(size_t size, size_t first_bin)
+  {
+    _stored.size = size;
+    _stored.first_bin = first_bin;
+    _stored.samplerate = _samplerate;
+    _stored.frames = 0;
+    _stored.values.fill(0.0);
+    _score = 0.0;
+    _dirty = false;
+  }
+
+  // Loads the baseline of the spectrum, or starts a new
+  // one if there is none stored for the same samplerate.
+  void load(size_t size, size_t first_bin)
+  {
+    start(size, first_bin);
+    nvs_handle_t handle;
+    if(nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK)
+    {
+      return;
+    }
+    size_t length = sizeof(_stored);
+    if(nvs_get_blob(handle, key().data(), &_stored, &length) != ESP_OK
+       || length != offsetof(stored_t, values) + size * sizeof(float)
+       || _stored.size != size
+       || _stored.first_bin != first_bin
+       || _stored.samplerate != _samplerate)
+    {
+      ESP_LOGW("baseline", "no usable baseline stored for %i bins from %i", int(size), int(first_bin));
+      start(size, first_bin);
+    }
+    nvs_close(handle);
+  }
+
+  // NVS keys are limited to 15 characters
+  std::array<char, 16> key() const
+  {
+    std::array<char, 16> res;
+    snprintf(res.data(), res.size(), "bl%u-%u", unsigned(_stored.size), unsigned(_stored.first_bin));
+    return res;
+  }
+
+  uint32_t _samplerate;
+  stored_t _stored;
+  float _score;
+  bool _dirty;
+};
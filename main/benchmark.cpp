@@ -0,0 +1,293 @@
+// Copyright: 2020, Diez B. Roggisch, Berlin, all rights reserved
+#include "benchmark.hh"
+#include "fft.hh"
+#include "sdft.hh"
+#include "fixed-fft.hh"
+#include "goertzel.hh"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <array>
+
+namespace {
+
+const auto TAG = "bench";
+
+const int HOP = 16;
+const int HOPS = 200;
+
+template<typename F>
+float per_hop_us(F f)
+{
+  const auto start = esp_timer_get_time();
+  for(int hop=0; hop < HOPS; ++hop)
+  {
+    f(hop);
+  }
+  return float(esp_timer_get_time() - start) / HOPS;
+}
+
+// The postprocessing as done before the fused pass:
+// normalise everything, |X|^2 via the conjugate, sqrtf and
+// double precision log10. Kept as reference for timing
+// and accuracy of FFT::postprocess.
+void reference_postprocess(std::vector<float>& fft, int n, size_t bins)
+{
+  std::transform(
+    fft.begin(),
+    fft.end(),
+    fft.begin(),
+    [n](const float v) { return v / n; }
+    );
+  for(size_t i=0; i < bins; ++i)
+  {
+    const auto re = fft[i * 2];
+    const auto im = fft[i * 2 + 1];
+    float cre, cim;
+    detail::complex_conjugate(re, im, cre, cim);
+    detail::complex_multiply(re, im, cre, cim, cre, cim);
+    const auto l = sqrtf(cre * cre + cim * cim);
+    // that was 20 * log10(|X|^2), we report 10 * log10(|X|^2)
+    fft[i] = 10 * log10(l);
+  }
+}
+
+template<int N>
+void benchmark_postprocess()
+{
+  auto fft = new FFT<N, HOP, RealInput>();
+  for(int i=0; i < N; ++i)
+  {
+    if(fft->feed(sinf(i * 0.3f) + 0.1f * sinf(i * 2.9f)))
+    {
+      fft->compute();
+    }
+  }
+  std::vector<float> spectrum, reference, fused;
+  fft->copy_fft(spectrum);
+  const auto bins = fft->bins();
+
+  const auto reference_us = per_hop_us(
+    [&](int)
+    {
+      reference = spectrum;
+      reference_postprocess(reference, N, bins);
+    });
+  const auto fused_us = per_hop_us(
+    [&](int)
+    {
+      fused = spectrum;
+      for(size_t i=0; i < bins; ++i)
+      {
+        fused[i] = detail::power_db(fused[i * 2], fused[i * 2 + 1], detail::ilog2(N));
+      }
+    });
+  float max_error = 0.0;
+  for(size_t i=0; i < bins; ++i)
+  {
+    max_error = std::max(max_error, fabsf(fused[i] - reference[i]));
+  }
+  ESP_LOGI(
+    TAG, "N=%i postprocess reference: %.1fus, fused: %.1fus, max error: %.4fdB",
+    N, reference_us, fused_us, max_error);
+  delete fft;
+}
+
+// The input window as kept before it became circular:
+// each hop shifts the whole window with std::copy, appends
+// the new samples and windows it linearly. Kept as reference
+// for timing FFT::update_input and apply_window.
+template<int N>
+struct ReferenceInput
+{
+  std::array<float, N> input;
+  std::array<float, N> windowed;
+
+  ReferenceInput()
+  {
+    input.fill(0.0);
+  }
+
+  template<typename F>
+  void update(F sample)
+  {
+    std::copy(input.begin() + HOP, input.end(), input.begin());
+    for(size_t i=N - HOP; i < N; ++i)
+    {
+      input[i] = sample();
+    }
+    const auto& window = detail::WindowTable<N, HannWindow>::values;
+    for(size_t i=0; i < N; ++i)
+    {
+      windowed[i] = input[i] * window[i];
+    }
+  }
+};
+
+template<int N>
+void benchmark_fft_size()
+{
+  auto fft = new FFT<N, HOP, RealInput>();
+  auto reference = new ReferenceInput<N>();
+  int sample = 0;
+  const auto feed = [&]()
+                    {
+                      for(int i=0; i < HOP; ++i)
+                      {
+                        fft->feed(sinf(sample++ * 0.1f));
+                      }
+                    };
+  const auto linear = per_hop_us(
+    [&](int)
+    {
+      reference->update([&]() { return sinf(sample++ * 0.1f); });
+    });
+  const auto circular = per_hop_us(
+    [&](int)
+    {
+      feed();
+      fft->update_input();
+      fft->apply_window();
+    });
+  const auto compute = per_hop_us(
+    [&](int)
+    {
+      feed();
+      fft->compute();
+    });
+  ESP_LOGI(
+    TAG, "N=%i input+window linear: %.1fus/hop, circular: %.1fus/hop, compute: %.1fus/hop",
+    N, linear, circular, compute);
+  delete reference;
+  delete fft;
+}
+
+template<int N, int FIRST>
+void benchmark_sdft()
+{
+  auto sdft = new SlidingDFT<N, HOP, FIRST, N / 2>();
+  int sample = 0;
+  const auto compute = per_hop_us(
+    [&](int)
+    {
+      for(int i=0; i < HOP; ++i)
+      {
+        sdft->feed(sinf(sample++ * 0.1f));
+      }
+      sdft->compute();
+    });
+  ESP_LOGI(TAG, "N=%i sliding DFT bins %i..%i: %.1fus/hop", N, FIRST, N / 2, compute);
+  delete sdft;
+}
+
+template<int K, int N>
+void benchmark_goertzel()
+{
+  auto bank = new GoertzelBank<K, N, HOP>();
+  std::array<float, K> frequencies;
+  for(int i=0; i < K; ++i)
+  {
+    frequencies[i] = 50.0f * (i + 1);
+  }
+  bank->tune(1000.0, frequencies);
+  int sample = 0;
+  const auto compute = per_hop_us(
+    [&](int)
+    {
+      for(int i=0; i < HOP; ++i)
+      {
+        bank->feed(sinf(sample++ * 0.1f));
+      }
+      bank->compute();
+      bank->postprocess();
+    });
+  ESP_LOGI(TAG, "Goertzel bank K=%i: %.1fus/hop", K, compute);
+  delete bank;
+}
+
+// Runs the float and the Q15 path side by side over the same
+// signal. The error is only taken over bins within 60dB of
+// the peak, below that the Q15 quantisation floor dominates.
+template<int N>
+void benchmark_fixed_point()
+{
+  auto fft = new FFT<N, HOP, RealInput>();
+  auto fixed = new FixedFFT<N, HOP>(2.0);
+  int sample = 0;
+  float max_error = 0.0, error_sum = 0.0;
+  int error_count = 0;
+  const auto signal = [&]()
+                      {
+                        const auto t = float(sample++);
+                        return 0.5f * sinf(t * 0.37f) + 0.05f * sinf(t * 1.3f) + 0.01f * sinf(t * 2.9f);
+                      };
+  for(int i=0; i < N * 4; ++i)
+  {
+    const auto v = signal();
+    fixed->feed(v);
+    if(fft->feed(v))
+    {
+      fft->compute();
+      fixed->compute();
+      fft->postprocess();
+      fixed->postprocess();
+      const auto peak = *std::max_element(fft->fft().begin(), fft->fft().begin() + N / 2);
+      for(int k=1; k < N / 2; ++k)
+      {
+        if(fft->fft()[k] > peak - 60)
+        {
+          const auto error = fabsf(fft->fft()[k] - fixed->fft()[k]);
+          max_error = std::max(max_error, error);
+          error_sum += error;
+          ++error_count;
+        }
+      }
+    }
+  }
+  const auto float_us = per_hop_us(
+    [&](int)
+    {
+      for(int i=0; i < HOP; ++i)
+      {
+        fft->feed(signal());
+      }
+      fft->compute();
+      fft->postprocess();
+    });
+  const auto fixed_us = per_hop_us(
+    [&](int)
+    {
+      for(int i=0; i < HOP; ++i)
+      {
+        fixed->feed(signal());
+      }
+      fixed->compute();
+      fixed->postprocess();
+    });
+  ESP_LOGI(
+    TAG, "N=%i float: %.1fus/hop, Q15: %.1fus/hop, error max: %.2fdB mean: %.3fdB",
+    N, float_us, fixed_us, max_error, error_sum / error_count);
+  delete fixed;
+  delete fft;
+}
+
+} // end ns anonymous
+
+void run_benchmarks()
+{
+  benchmark_fft_size<2048>();
+  benchmark_postprocess<2048>();
+  benchmark_fft_size<1024>();
+  benchmark_fft_size<512>();
+  benchmark_fft_size<256>();
+  benchmark_postprocess<256>();
+  benchmark_sdft<256, 1>();
+  benchmark_fixed_point<256>();
+  benchmark_goertzel<4, 256>();
+  benchmark_goertzel<8, 256>();
+  benchmark_fixed_point<1024>();
+}
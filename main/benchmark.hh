@@ -0,0 +1,8 @@
+// Copyright: 2020, Diez B. Roggisch, Berlin, all rights reserved
+#pragma once
+#include <sdkconfig.h>
+#ifndef CONFIG_COFFEE_CLOCK_BENCHMARK
+#error "CONFIG_COFFEE_CLOCK_BENCHMARK not set!"
+#endif
+
+void run_benchmarks();
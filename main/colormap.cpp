@@ -1,6 +1,8 @@
 // Copyright: 2020, Diez B. Roggisch, Berlin, all rights reserved
 #include "colormap.hh"
 
+#include <sdkconfig.h>
+
 namespace {
 
 const std::array<uint32_t, 256> jet = {
@@ -123,7 +125,11 @@ void fill_palette(std::array<uint16_t, 256> &palette) {
     auto r = p[i] >> 16 & 0xff;
     auto g = p[i] >> 8 & 0xff;
     auto b = p[i] & 0xff;
+    #ifdef CONFIG_COFFEE_CLOCK_RGB444
+    color = ((r >> 4) << 8) | ((g >> 4) << 4) | (b >> 4);
+    #else
     color = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+    #endif
     palette[i] = color;
   }
 }
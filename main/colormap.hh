@@ -3,5 +3,7 @@
 #include <array>
 #include <cstdint>
 
-
+// Fills in the colours of the colour map as the panel
+// takes them, RGB565 or with CONFIG_COFFEE_CLOCK_RGB444
+// RGB444 in the lower 12 bits.
 void fill_palette(std::array<uint16_t, 256>& palette);
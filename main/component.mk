@@ -0,0 +1 @@
+CXXFLAGS += -std=gnu++17
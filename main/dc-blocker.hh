@@ -0,0 +1,42 @@
+// Copyright: 2020, Diez B. Roggisch, Berlin, all rights reserved
+#pragma once
+
+#include <math.h>
+
+// A first order highpass that removes DC and slow drift:
+//
+//   y[n] = x[n] - x[n-1] + p y[n-1]
+//
+// with the pole p = 1 - 2 pi corner / samplerate. Integrating
+// its output is the same as a leaky integrator of the input,
+// so an integrated gyro rate stays bounded even with a
+// bias left over from the calibration.
+class DCBlocker
+{
+public:
+  DCBlocker(float samplerate, float corner)
+    : _pole(1.0f - 2 * float(M_PI) * corner / samplerate)
+  {
+  }
+
+  float feed(float value)
+  {
+    // start from the first sample, otherwise
+    // its DC would be a step the filter rings on
+    if(!_primed)
+    {
+      _last_value = value;
+      _primed = true;
+    }
+    const auto res = value - _last_value + _pole * _last_output;
+    _last_value = value;
+    _last_output = res;
+    return res;
+  }
+
+private:
+  float _pole;
+  float _last_value = 0.0;
+  float _last_output = 0.0;
+  bool _primed = false;
+};
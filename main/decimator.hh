@@ -0,0 +1,120 @@
+// Copyright: 2020, Diez B. Roggisch, Berlin, all rights reserved
+#pragma once
+#include "fft-plan.hh"
+
+#include <array>
+
+namespace detail {
+
+// Windowed-sinc lowpass for decimation by M. The cutoff
+// sits at 80% of the decimated Nyquist frequency, the
+// Blackman-Harris window keeps the aliases of the
+// stopband well below the spectrum's floor.
+template<int M, int TAPS>
+struct DecimationTaps
+{
+  // the cutoff as fraction of the decimated Nyquist frequency
+  static constexpr double PASSBAND = 0.8;
+
+  static constexpr double sinc(double x)
+  {
+    return x == 0.0 ? 1.0 : constexpr_sin(PI * x) / (PI * x);
+  }
+
+  static constexpr std::array<float, TAPS> make()
+  {
+    const double cutoff = PASSBAND / (2.0 * M);
+    std::array<double, TAPS> taps = {};
+    double sum = 0.0;
+    for(int i=0; i < TAPS; ++i)
+    {
+      const double t = i - (TAPS - 1) / 2.0;
+      taps[i] = 2 * cutoff * sinc(2 * cutoff * t)
+        * WindowTable<TAPS, BlackmanHarrisWindow>::raw(i);
+      sum += taps[i];
+    }
+    std::array<float, TAPS> res = {};
+    for(int i=0; i < TAPS; ++i)
+    {
+      res[i] = float(taps[i] / sum);
+    }
+    return res;
+  }
+
+  static constexpr std::array<float, TAPS> values = make();
+};
+
+} // end ns detail
+
+// A FIR decimator by M, with TAPS compile time
+// generated lowpass coefficients.
+//
+// Only every M-th output is computed, which is the
+// same work as the polyphase decomposition. The history
+// is a mirrored double buffer, so the filter always
+// reads TAPS contiguous samples.
+template<int M, int TAPS>
+class Decimator
+{
+  static_assert(M >= 1, "decimation factor must be positive");
+  static_assert(TAPS % 2 == 1, "use an odd number of taps for a symmetric filter");
+
+public:
+  Decimator()
+  {
+    _history.fill(0.0);
+  }
+
+  // Returns true and the filtered value in out
+  // for every M-th input sample.
+  bool feed(float value, float& out)
+  {
+    _history[_head] = value;
+    _history[_head + TAPS] = value;
+    _head = (_head + 1) % TAPS;
+    if(++_phase < M)
+    {
+      return false;
+    }
+    _phase = 0;
+
+    // _head now points at the oldest sample
+    const auto& taps = detail::DecimationTaps<M, TAPS>::values;
+    const auto window = _history.data() + _head;
+    float accu = 0.0;
+    for(size_t i=0; i < TAPS; ++i)
+    {
+      accu += window[i] * taps[i];
+    }
+    out = accu;
+    return true;
+  }
+
+  static constexpr int factor()
+  {
+    return M;
+  }
+
+private:
+  std::array<float, TAPS * 2> _history;
+  size_t _head = 0;
+  int _phase = 0;
+};
+
+// Without decimation samples are passed through, and
+// neither history nor taps are kept.
+template<int TAPS>
+class Decimator<1, TAPS>
+{
+public:
+  bool feed(float value, float& out)
+  {
+    out = value;
+    return true;
+  }
+
+  static constexpr int factor()
+  {
+    return 1;
+  }
+};
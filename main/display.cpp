@@ -8,6 +8,9 @@
 #include "freertos/task.h"
 #include "driver/gpio.h"
 #include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include <sdkconfig.h>
 
 #include <array>
 #include <algorithm>
@@ -29,6 +32,66 @@ uint16_t _width = 135;
 uint16_t _height = 240;
 
 #define TRANSMIT_BUFFER 1
+#define TRANSMIT_DONE 2
+
+// rows per DMA transfer
+const int DMA_LINES = 16;
+const int MAX_TRANSFER_SIZE = SPIFIFOSIZE * 240 * 2 + 8;
+
+static_assert(DMA_LINES * 240 * 2 <= MAX_TRANSFER_SIZE, "DMA buffers exceed the maximum transfer size");
+
+#ifdef CONFIG_COFFEE_CLOCK_RGB444
+const uint8_t COLMOD = 0x53;
+const uint16_t WHITE = 0x0fff;
+
+// only the last chunk of a window may have an odd
+// number of pixels
+static_assert(DMA_LINES % 2 == 0, "RGB444 needs an even number of DMA lines");
+
+size_t pixel_bytes(size_t pixels)
+{
+  return (pixels * 3 + 1) / 2;
+}
+
+// Packs two pixels into three bytes. An odd last pixel
+// is padded, the panel drops the incomplete pixel when
+// the next command arrives.
+void convert_pixels(const std::array<uint16_t, 256>& palette, const uint8_t* source, size_t pixels, uint8_t* dest)
+{
+  for(size_t i=0; i + 1 < pixels; i += 2)
+  {
+    const auto a = palette[source[i]];
+    const auto b = palette[source[i + 1]];
+    *dest++ = a >> 4;
+    *dest++ = (a << 4) | (b >> 8);
+    *dest++ = b;
+  }
+  if(pixels % 2)
+  {
+    const auto a = palette[source[pixels - 1]];
+    *dest++ = a >> 4;
+    *dest++ = a << 4;
+  }
+}
+#else
+const uint8_t COLMOD = 0x55;
+const uint16_t WHITE = 0xffff;
+
+size_t pixel_bytes(size_t pixels)
+{
+  return pixels * 2;
+}
+
+void convert_pixels(const std::array<uint16_t, 256>& palette, const uint8_t* source, size_t pixels, uint8_t* dest)
+{
+  for(size_t i=0; i < pixels; ++i)
+  {
+    const auto color = palette[source[i]];
+    *dest++ = color >> 8;
+    *dest++ = color;
+  }
+}
+#endif
 
 std::stringstream to_str(const font_render_t& fr)
 {
@@ -163,7 +226,7 @@ void Display::lcd_init(spi_device_handle_t spi)
   lcd_write_u8(spi, 0x82);
 
   lcd_cmd(spi, ST7789_COLMOD);
-  lcd_write_u8(spi, 0x55);
+  lcd_write_u8(spi, COLMOD);
   vTaskDelay(10 / portTICK_RATE_MS);
 
   //--------------------------------ST7789V Frame rate setting----------------------------------//
@@ -302,6 +365,12 @@ void Display::setRotation(spi_device_handle_t spi, uint8_t m)
     }
 }
 
+void Display::setScrollStart(spi_device_handle_t spi)
+{
+  lcd_cmd(spi, ST7789_VSCSAD);
+  lcd_write_word(spi, rowstart + _top_fixed + _transmit_scroll);
+}
+
 
 Display::Display()
 {
@@ -315,7 +384,7 @@ Display::Display()
   buscfg.sclk_io_num = PIN_NUM_CLK;
   buscfg.quadwp_io_num = -1;
   buscfg.quadhd_io_num = -1;
-  buscfg.max_transfer_sz = SPIFIFOSIZE * 240 * 2 + 8;
+  buscfg.max_transfer_sz = MAX_TRANSFER_SIZE;
 
   spi_device_interface_config_t devcfg = {
     .command_bits = 0,
@@ -344,11 +413,29 @@ Display::Display()
   setRotation(_spi, 0);
 
   _buffer.resize(width() * height());
+  #ifdef CONFIG_COFFEE_CLOCK_DOUBLE_BUFFER
+  _front.resize(_buffer.size());
+  #endif
+  _transmit_buffer = _buffer.data();
+  // without a scroll area, all rows are fixed
+  _top_fixed = height();
+  _scroll = 0;
+  _dirty_rows.resize(height());
+  _transmit_rows.resize(height());
+  _transmit_scroll = 0;
   fill_palette(_palette);
   // always tie 0 to black and 1 to white
   _palette[0] = 0x0;
-  _palette[1] = 0xffff;
-  _line.resize(width());
+  _palette[1] = WHITE;
+  for(auto& line : _lines)
+  {
+    line = static_cast<uint8_t*>(
+      heap_caps_malloc(pixel_bytes(DMA_LINES * std::max(_init_width, _init_height)), MALLOC_CAP_DMA)
+      );
+    assert(line);
+  }
+  _transfer_time = 0;
+  _transfer_size = 0;
   _update_events = xEventGroupCreate();
   assert(_update_events);
 
@@ -375,11 +462,67 @@ int Display::width() const { return _width; }
 void Display::clear()
 {
   std::memset(_buffer.data(), 0, _buffer.size());
+  _dirty_rows.mark_all();
+}
+
+void Display::set_scroll_area(int top_fixed)
+{
+  // the scroll direction follows the panel rows, which
+  // only match ours in the portrait orientation
+  wait_for_update();
+  assert(top_fixed >= 0 && top_fixed < height());
+  _top_fixed = top_fixed;
+  _scroll = 0;
+  _transmit_scroll = 0;
+  _dirty_rows.mark_all();
+  lcd_cmd(_spi, ST7789_VSCRDEF);
+  lcd_write_word(_spi, rowstart + _top_fixed);
+  lcd_write_word(_spi, height() - _top_fixed);
+  lcd_write_word(_spi, ST7789_GRAM_LINES - rowstart - height());
+  setScrollStart(_spi);
+}
+
+int Display::buffer_row(int y) const
+{
+  if(y < _top_fixed)
+  {
+    return y;
+  }
+  return _top_fixed + (y - _top_fixed + _scroll) % (height() - _top_fixed);
 }
 
 void Display::update() {
-    _spi_transaction_ongoing = true;
-    xEventGroupSetBits(_update_events, TRANSMIT_BUFFER);
+  wait_for_update();
+  #ifdef CONFIG_COFFEE_CLOCK_DOUBLE_BUFFER
+  _front.swap(_buffer);
+  _transmit_buffer = _front.data();
+  #endif
+  _transmit_rows = _dirty_rows;
+  _transmit_scroll = _scroll;
+  _dirty_rows.clear();
+  _spi_transaction_ongoing = true;
+  xEventGroupSetBits(_update_events, TRANSMIT_BUFFER);
+  #ifdef CONFIG_COFFEE_CLOCK_DOUBLE_BUFFER
+  // The back buffer still holds the frame before, so it
+  // gets the rows which changed since. Both are only read
+  // while transmitting.
+  for(int row=0; row < height(); ++row)
+  {
+    if(_transmit_rows[row])
+    {
+      std::copy_n(_front.begin() + row * width(), width(), _buffer.begin() + row * width());
+    }
+  }
+  #endif
+}
+
+void Display::wait_for_update()
+{
+  while(_spi_transaction_ongoing)
+  {
+    xEventGroupWaitBits(
+      _update_events, TRANSMIT_DONE, pdTRUE, pdFALSE, portMAX_DELAY);
+  }
 }
 
 void Display::update_task()
@@ -394,32 +537,108 @@ void Display::update_task()
       portMAX_DELAY);/* Wait a maximum of 100ms for either bit to be set. */
     update_work();
     _spi_transaction_ongoing = false;
+    xEventGroupSetBits(_update_events, TRANSMIT_DONE);
   }
 }
 
 void Display::update_work()
 {
-  setAddress(_spi, 0, 0, width() - 1, height() - 1);
-  size_t offset = 0;
+  const auto start = esp_timer_get_time();
+  uint32_t size = 0;
+  // each span of changed rows gets its own window
+  for(int row=0; row < height();)
+  {
+    if(!_transmit_rows[row])
+    {
+      ++row;
+      continue;
+    }
+    auto last = row + 1;
+    while(last < height() && _transmit_rows[last])
+    {
+      ++last;
+    }
+    size += transmit_rows(row, last);
+    row = last;
+  }
+  if(_top_fixed < height())
+  {
+    setScrollStart(_spi);
+    // command and start address
+    size += 3;
+  }
+  _transfer_size = size;
+  _transfer_time = esp_timer_get_time() - start;
+}
+
+/* Transmits the rows [first, last) in chunks of DMA_LINES.
+ *
+ * The chunks are queued, so while one is transmitted the next is
+ * converted into the other buffer. Before a buffer is reused, its
+ * previous transfer has to be finished. All transfers are done when
+ * this returns, as the commands of the next window are polled.
+ */
+uint32_t Display::transmit_rows(int first, int last)
+{
+  if(first == last)
+  {
+    return 0;
+  }
+  setAddress(_spi, 0, first, width() - 1, last - 1);
+  size_t in_flight = 0;
+  size_t current = 0;
 
-  for(size_t y=0; y < height(); ++y)
+  for(int y=first; y < last; y += DMA_LINES)
   {
-    for(size_t x=0; x < width(); ++x)
+    if(in_flight == _lines.size())
     {
-      _line[x] = SWAPBYTES(_palette[_buffer[offset + x]]);
+      wait_for_transfer();
+      --in_flight;
     }
-    offset += width();
-    std::memset(&_spi_transaction, 0, sizeof(_spi_transaction));  //Zero out the transaction
-    _spi_transaction.tx_buffer = _line.data();  //Data
-    dc(_spi_transaction, 1);
-    _spi_transaction.length = sizeof(decltype(_line)::value_type) * _line.size() * 8;   //Len is in byte
-    spi_device_transmit(_spi, &_spi_transaction);
+    const auto rows = std::min(DMA_LINES, last - y);
+    auto line = _lines[current];
+    convert_pixels(_palette, _transmit_buffer + y * width(), rows * width(), line);
+    auto& t = _transactions[current];
+    std::memset(&t, 0, sizeof(t));  //Zero out the transaction
+    t.tx_buffer = line;  //Data
+    dc(t, 1);
+    t.length = pixel_bytes(rows * width()) * 8;   //Len is in bits
+    ESP_ERROR_CHECK(spi_device_queue_trans(_spi, &t, portMAX_DELAY));
+    ++in_flight;
+    current = (current + 1) % _lines.size();
   }
+  while(in_flight--)
+  {
+    wait_for_transfer();
+  }
+  // the window takes three commands with eight bytes
+  // of coordinates
+  return 3 + 8 + pixel_bytes((last - first) * width());
+}
+
+void Display::wait_for_transfer()
+{
+  spi_transaction_t* t;
+  ESP_ERROR_CHECK(spi_device_get_trans_result(_spi, &t, portMAX_DELAY));
 }
 
 bool Display::ready()
 {
+  #ifdef CONFIG_COFFEE_CLOCK_DOUBLE_BUFFER
+  return true;
+  #else
   return !_spi_transaction_ongoing.load();
+  #endif
+}
+
+uint32_t Display::transfer_time() const
+{
+  return _transfer_time;
+}
+
+uint32_t Display::transfer_size() const
+{
+  return _transfer_size;
 }
 
 void Display::dc(spi_transaction_t& t, int dc)
@@ -430,7 +649,9 @@ void Display::dc(spi_transaction_t& t, int dc)
 
 void Display::draw_pixel(int x, int y, uint8_t color)
 {
-  _buffer[x + y * width()] = color;
+  const auto row = buffer_row(y);
+  _buffer[x + row * width()] = color;
+  _dirty_rows.mark(row, row + 1);
 }
 
 void Display::set_color(uint8_t color)
@@ -458,7 +679,18 @@ void Display::circle(int x0, int y0, int rad, bool filled)
 
 void Display::vscroll()
 {
-  std::copy(_buffer.begin() + width(), _buffer.end(), _buffer.begin());
+  if(_top_fixed == height())
+  {
+    std::copy(_buffer.begin() + width(), _buffer.end(), _buffer.begin());
+    _dirty_rows.mark_all();
+    return;
+  }
+  // the oldest row becomes the new bottom row, the
+  // panel follows with the next scroll start address.
+  _scroll = (_scroll + 1) % (height() - _top_fixed);
+  const auto row = buffer_row(height() - 1);
+  std::memset(_buffer.data() + row * width(), 0, width());
+  _dirty_rows.mark(row, row + 1);
 }
 
 
@@ -11,14 +11,51 @@
 
 #include <vector>
 #include <array>
+#include <algorithm>
 #include <atomic>
 
+// The rows of a framebuffer which changed since it
+// was last transmitted.
+class DirtyRows
+{
+public:
+  void resize(size_t rows)
+  {
+    _rows.resize(rows, true);
+  }
+
+  // marks the rows [first, last)
+  void mark(size_t first, size_t last)
+  {
+    std::fill(_rows.begin() + first, _rows.begin() + std::min(last, _rows.size()), true);
+  }
+
+  void mark_all()
+  {
+    mark(0, _rows.size());
+  }
+
+  bool operator[](size_t row) const
+  {
+    return _rows[row];
+  }
+
+  void clear()
+  {
+    std::fill(_rows.begin(), _rows.end(), false);
+  }
+
+private:
+  std::vector<bool> _rows;
+};
+
 class Sprite {
 public:
-  Sprite(size_t width, size_t height, uint8_t* image=nullptr, int mask=-1)
+  Sprite(size_t width, size_t height, uint8_t* image=nullptr, int mask=-1, DirtyRows* dirty=nullptr)
     : _width(width)
     , _height(height)
     , _mask(mask)
+    , _dirty(dirty)
   {
     if(image)
     {
@@ -60,6 +97,16 @@ public:
     return _image;
   }
 
+  // Tells the owner of the image which rows changed,
+  // if it cares.
+  void mark_dirty(size_t first, size_t last)
+  {
+    if(_dirty)
+    {
+      _dirty->mark(first, last);
+    }
+  }
+
   template<class T>
   void blit(T& other, size_t x, size_t y)
   {
@@ -73,12 +120,14 @@ public:
       dest += x + other.width() * y;
       auto source = _image;
       copy(source, dest, modulo, width(), height());
+      other.mark_dirty(y, y + height());
     }
   }
 
   void fill(uint8_t color)
   {
     std::memset(_image, color, _width * _height);
+    mark_dirty(0, _height);
   }
 
 
@@ -105,6 +154,7 @@ private:
   uint8_t* _image;
   bool _borrowed;
   int _mask;
+  DirtyRows* _dirty;
 };
 
 class BufferedSprite: public Sprite
@@ -131,6 +181,7 @@ public:
       auto source = _buffer.data();
       dest += other.width() * _y + _x;
       copy(source, dest, modulo, width(), height());
+      other.mark_dirty(_y, _y + height());
     }
     _buffered = false;
   }
@@ -172,7 +223,16 @@ class Display {
 public:
   Display();
 
+  // Whether we can draw. With a double buffer this is
+  // always the case, and update() waits for the last
+  // transfer to finish before it swaps the buffers.
   bool ready();
+  // how long the last update took to transmit, in
+  // microseconds
+  uint32_t transfer_time() const;
+  // how many bytes the last update sent, only rows which
+  // were drawn since the previous one are transmitted
+  uint32_t transfer_size() const;
 
   int height() const;
   int width() const;
@@ -184,10 +244,18 @@ public:
   void circle(int x0, int y0, int rad, bool filled=false);
   void hline(int x, int x2, int y);
   void vline(int x, int y1, int y2, uint8_t color);
+  // Scrolls everything below the fixed top rows up by one
+  // row.
   void vscroll();
+  // Lets the panel scroll the rows from top_fixed to the
+  // bottom in hardware. The framebuffer then keeps them as
+  // a ring.
+  void set_scroll_area(int top_fixed);
+  // The framebuffer as a sprite. With a scroll area only
+  // the fixed rows are laid out linearly.
   Sprite sprite()
   {
-    return Sprite(width(), height(), _buffer.data());
+    return Sprite(width(), height(), _buffer.data(), -1, &_dirty_rows);
   }
 
   void render_text(Sprite& dest, const char *text, int cx, int cy, uint8_t fg, uint8_t bg);
@@ -203,23 +271,46 @@ private:
   void lcd_write_word(spi_device_handle_t spi, const uint16_t data);
   void setAddress(spi_device_handle_t spi, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2);
   void setRotation(spi_device_handle_t spi, uint8_t m);
+  void setScrollStart(spi_device_handle_t spi);
+
+  // maps a row onto the framebuffer, which mirrors the
+  // panel memory
+  int buffer_row(int y) const;
+  // returns the bytes sent
+  uint32_t transmit_rows(int first, int last);
+  void wait_for_transfer();
 
   void dc(spi_transaction_t&, int);
 
   static void s_update_task(void*);
   void update_task();
   void update_work();
+  void wait_for_update();
 
   spi_device_handle_t _spi;
+  // we draw into _buffer, and with a double buffer
+  // transmit _front
   std::vector<uint8_t> _buffer;
+  std::vector<uint8_t> _front;
+  const uint8_t* _transmit_buffer;
   std::array<uint16_t, 256> _palette;
-  std::vector<uint16_t> _line;
+  // DMA capable buffers of several rows, one is converted
+  // while the other is transmitted
+  std::array<uint8_t*, 2> _lines;
+  std::array<spi_transaction_t, 2> _transactions;
+  int _top_fixed;
+  int _scroll;
+  DirtyRows _dirty_rows;
+  // the state of the frame being transmitted
+  DirtyRows _transmit_rows;
+  int _transmit_scroll;
   EventGroupHandle_t _update_events;
 
   TaskHandle_t _update_task_handle;
-  spi_transaction_t _spi_transaction;
   int _dc;
   std::atomic<bool> _spi_transaction_ongoing;
+  std::atomic<uint32_t> _transfer_time;
+  std::atomic<uint32_t> _transfer_size;
 
   font_face_t _font_face;
   font_render_t _font_render;
@@ -0,0 +1,156 @@
+// Copyright: 2020, Diez B. Roggisch, Berlin, all rights reserved
+#pragma once
+#include "fft.hh"
+
+#include <stddef.h>
+#include <array>
+#include <utility>
+#include <variant>
+
+template<int N, int OVERLAP>
+struct FFTConfig
+{
+  static constexpr int SIZE = N;
+  static constexpr int HOP = OVERLAP;
+};
+
+// Switches between real-input FFTs of different sizes and
+// hops at runtime.
+//
+// All configurations are instantiated at compile time, but
+// only the active one lives, in a std::variant which is sized
+// for the largest. So switching constructs the new FFT in
+// place, without touching the heap. The interface mirrors
+// the FFT engines, each call is dispatched to the active one.
+template<typename Mask, typename... Configs>
+class FFTDispatcher
+{
+  using variant_t = std::variant<
+    FFT<Configs::SIZE, Configs::HOP, RealInput, HannWindow, Mask>...
+    >;
+
+  static constexpr std::array<int, sizeof...(Configs)> SIZES = { Configs::SIZE... };
+  static constexpr std::array<int, sizeof...(Configs)> HOPS = { Configs::HOP... };
+
+public:
+  // A view on the dB values of the active FFT
+  struct spectrum_t
+  {
+    const float* _begin;
+    const float* _end;
+
+    const float* begin() const
+    {
+      return _begin;
+    }
+
+    const float* end() const
+    {
+      return _end;
+    }
+  };
+
+  static constexpr size_t count()
+  {
+    return sizeof...(Configs);
+  }
+
+  void select(size_t index)
+  {
+    select(index, std::make_index_sequence<sizeof...(Configs)>());
+  }
+
+  // Selects the configuration of transform size n,
+  // returns false if there is none.
+  bool select_size(int n)
+  {
+    for(size_t i=0; i < count(); ++i)
+    {
+      if(SIZES[i] == n)
+      {
+        select(i);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void next()
+  {
+    select((index() + 1) % count());
+  }
+
+  size_t index() const
+  {
+    return _engine.index();
+  }
+
+  int overlap() const
+  {
+    return HOPS[index()];
+  }
+
+  bool feed(float value)
+  {
+    return std::visit([value](auto& fft) { return fft.feed(value); }, _engine);
+  }
+
+  void update_input()
+  {
+    std::visit([](auto& fft) { fft.update_input(); }, _engine);
+  }
+
+  void transform()
+  {
+    std::visit([](auto& fft) { fft.transform(); }, _engine);
+  }
+
+  void compute()
+  {
+    update_input();
+    transform();
+  }
+
+  void postprocess(size_t first, size_t last)
+  {
+    std::visit([first, last](auto& fft) { fft.postprocess(first, last); }, _engine);
+  }
+
+  void postprocess()
+  {
+    postprocess(0, bins());
+  }
+
+  size_t size() const
+  {
+    return SIZES[index()];
+  }
+
+  size_t bins() const
+  {
+    return size() / 2;
+  }
+
+  template<typename T>
+  size_t copy_fft(T& container)
+  {
+    return std::visit([&container](auto& fft) { return fft.copy_fft(container); }, _engine);
+  }
+
+  spectrum_t fft() const
+  {
+    const auto begin = std::visit([](const auto& fft) { return fft.fft().data(); }, _engine);
+    return { begin, begin + bins() };
+  }
+
+private:
+  template<size_t... Is>
+  void select(size_t index, std::index_sequence<Is...>)
+  {
+    // the variant needs the index at compile time
+    // so we dispatch over all of them
+    ((Is == index ? (_engine.template emplace<Is>(), 0) : 0), ...);
+  }
+
+  variant_t _engine;
+};
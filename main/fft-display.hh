@@ -1,9 +1,11 @@
 // Copyright: 2020, Diez B. Roggisch, Berlin, all rights reserved
 #pragma once
 #include "display.hh"
+#include "notch-mask.hh"
 #include <esp_log.h>
 
 #include <cmath>
+#include <limits>
 #include <optional>
 
 float lerp(float a, float b, float f) { return a + f * (b - a); }
@@ -48,12 +50,16 @@ public:
       for(; begin != end; ++begin)
       {
         const auto value = *begin;
-        _bars[i] += value;
-        ++divider;
+        // masked bins don't count towards their bar
+        if(value > MASKED_DB)
+        {
+          _bars[i] += value;
+          ++divider;
+        }
         accu -= W;
         if(accu <= 0)
         {
-          _bars[i] /= divider;
+          _bars[i] = divider ? _bars[i] / divider : MASKED_DB;
           divider = 0;
           accu += fft_width;
           ++i;
@@ -67,9 +73,9 @@ public:
         const auto position = lerp(0.0, fft_width - 1, float(i) / (W - 1));
         const auto lower = int(floor(position));
         const auto upper = int(ceil(position));
-        if(lower == upper)
+        if(lower == upper || *(begin + lower) <= MASKED_DB || *(begin + upper) <= MASKED_DB)
         {
-          _bars[i] = *(begin + lower);
+          _bars[i] = std::min(*(begin + lower), *(begin + upper));
         }
         else
         {
@@ -81,15 +87,30 @@ public:
 
   void render(Display& display, int x, int y)
   {
-    const auto min = Transform::transform(*std::min_element(_bars.begin(), _bars.end()));
-    const auto max = Transform::transform(*std::max_element(_bars.begin(), _bars.end()));
-    const auto diff = max - min;
-    const auto scale = filtered_scale(diff);
+    // masked bars neither take part in the
+    // scale nor are they drawn
+    auto min = std::numeric_limits<float>::max();
+    auto max = std::numeric_limits<float>::lowest();
+    for(const auto& bar : _bars)
+    {
+      if(bar > MASKED_DB)
+      {
+        min = std::min(min, bar);
+        max = std::max(max, bar);
+      }
+    }
+    const auto scale = min <= max ? filtered_scale(
+      Transform::transform(max) - Transform::transform(min)
+      ) : _filtered_scale;
     std::transform(
       _bars.begin(),
       _bars.end(),
       _color.begin(),
       [&](const float v) {
+        if(v <= MASKED_DB)
+        {
+          return uint8_t(0);
+        }
         return uint8_t(2.0 + std::min(v * scale, 253.0f));
       });
     int xs = 0;
@@ -99,6 +120,19 @@ public:
     }
   }
 
+  // The axis of a multi axis FFT to show. The spectra
+  // come through the averager, so whoever feeds it asks
+  // for the axis.
+  void select_axis(int axis)
+  {
+    _axis = axis;
+  }
+
+  int axis() const
+  {
+    return _axis;
+  }
+
   float filtered_scale(float diff)
   {
     auto new_scale = 253.0 / diff;
@@ -113,6 +147,7 @@ public:
 private:
   float _filtered_scale = NO_SCALE;
   float _scale_gain = 0.01;
+  int _axis = 0;
   std::array<float, W> _bars;
   std::array<uint8_t, W> _color;
 };
@@ -0,0 +1,316 @@
+// Copyright: 2020, Diez B. Roggisch, Berlin, all rights reserved
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <array>
+#include <algorithm>
+#include <utility>
+
+// Compile time generated tables for the FFTs. They are all
+// static constexpr, so they end up in .rodata and thus
+// flash, and each transform size gets its own tables
+// instead of sharing the global twiddle table of esp-dsp.
+
+namespace detail {
+
+constexpr double PI = 3.14159265358979323846;
+
+// constexpr replacements for sin/cos, good to
+// double precision for the arguments we need.
+constexpr double constexpr_sin(double x)
+{
+  while(x > PI)
+  {
+    x -= 2 * PI;
+  }
+  while(x < -PI)
+  {
+    x += 2 * PI;
+  }
+  double term = x;
+  double result = x;
+  for(int i=1; i < 24; ++i)
+  {
+    term *= -x * x / ((2 * i) * (2 * i + 1));
+    result += term;
+  }
+  return result;
+}
+
+constexpr double constexpr_cos(double x)
+{
+  return constexpr_sin(x + PI / 2);
+}
+
+// e^(-2 pi i k / N) for k in [0, COUNT), interleaved re/im
+template<int N, int COUNT>
+struct TwiddleTable
+{
+  static constexpr std::array<float, COUNT * 2> make()
+  {
+    std::array<float, COUNT * 2> res = {};
+    for(int k=0; k < COUNT; ++k)
+    {
+      res[k * 2] = float(constexpr_cos(2 * PI * k / N));
+      res[k * 2 + 1] = float(-constexpr_sin(2 * PI * k / N));
+    }
+    return res;
+  }
+
+  static constexpr std::array<float, COUNT * 2> values = make();
+};
+
+template<int N>
+struct BitReverseTable
+{
+  static_assert(N <= 65536, "indices must fit into uint16_t");
+
+  static constexpr std::array<uint16_t, N> make()
+  {
+    std::array<uint16_t, N> res = {};
+    int bits = 0;
+    while((1 << bits) < N)
+    {
+      ++bits;
+    }
+    for(int i=0; i < N; ++i)
+    {
+      int reversed = 0;
+      for(int b=0; b < bits; ++b)
+      {
+        reversed |= ((i >> b) & 1) << (bits - 1 - b);
+      }
+      res[i] = uint16_t(reversed);
+    }
+    return res;
+  }
+
+  static constexpr std::array<uint16_t, N> values = make();
+};
+
+// In-place radix-2 decimation in time FFT over N
+// interleaved complex values, output in natural order.
+template<int N>
+void fft_radix2(float* data)
+{
+  const auto& bitrev = BitReverseTable<N>::values;
+  const auto& twiddle = TwiddleTable<N, N / 2>::values;
+
+  for(int i=0; i < N; ++i)
+  {
+    const int j = bitrev[i];
+    if(i < j)
+    {
+      std::swap(data[i * 2], data[j * 2]);
+      std::swap(data[i * 2 + 1], data[j * 2 + 1]);
+    }
+  }
+
+  for(int len=2, step=N / 2; len <= N; len *= 2, step /= 2)
+  {
+    const int half = len / 2;
+    for(int i=0; i < N; i += len)
+    {
+      for(int j=0; j < half; ++j)
+      {
+        const auto wre = twiddle[j * step * 2];
+        const auto wim = twiddle[j * step * 2 + 1];
+        auto u = data + (i + j) * 2;
+        auto v = data + (i + j + half) * 2;
+        const auto vre = v[0] * wre - v[1] * wim;
+        const auto vim = v[0] * wim + v[1] * wre;
+        v[0] = u[0] - vre;
+        v[1] = u[1] - vim;
+        u[0] += vre;
+        u[1] += vim;
+      }
+    }
+  }
+}
+
+// Generalised cosine window, symmetric like the esp-dsp windows:
+// w[i] = a0 - a1 cos(2 pi i / (N - 1)) + a2 cos(4 pi i / (N - 1)) - ...
+//
+// The table is scaled by the amplitude correction N / sum(w),
+// so a sinusoid has the same amplitude in the spectrum
+// regardless of the window.
+template<int N, typename Window>
+struct WindowTable
+{
+  static constexpr double raw(int i)
+  {
+    double res = 0.0;
+    double sign = 1.0;
+    for(size_t k=0; k < Window::COEFFICIENTS.size(); ++k)
+    {
+      res += sign * Window::COEFFICIENTS[k] * constexpr_cos(2 * PI * k * i / (N - 1));
+      sign = -sign;
+    }
+    return res;
+  }
+
+  static constexpr double make_correction()
+  {
+    double sum = 0.0;
+    for(int i=0; i < N; ++i)
+    {
+      sum += raw(i);
+    }
+    return N / sum;
+  }
+
+  static constexpr std::array<float, N> make()
+  {
+    std::array<float, N> res = {};
+    for(int i=0; i < N; ++i)
+    {
+      res[i] = float(raw(i) * correction);
+    }
+    return res;
+  }
+
+  static constexpr double correction = make_correction();
+  static constexpr std::array<float, N> values = make();
+};
+
+// The same tables as Q15 fixed point values. The windows
+// are not amplitude corrected, as that would overflow Q15,
+// the correction has to be applied later on.
+inline constexpr int16_t to_q15(double v)
+{
+  const auto scaled = v * 32768.0 + (v < 0 ? -0.5 : 0.5);
+  return scaled >= 32767.0 ? 32767 : (scaled <= -32768.0 ? -32768 : int16_t(scaled));
+}
+
+template<int N, int COUNT>
+struct TwiddleTableQ15
+{
+  static constexpr std::array<int16_t, COUNT * 2> make()
+  {
+    std::array<int16_t, COUNT * 2> res = {};
+    for(int k=0; k < COUNT; ++k)
+    {
+      res[k * 2] = to_q15(constexpr_cos(2 * PI * k / N));
+      res[k * 2 + 1] = to_q15(-constexpr_sin(2 * PI * k / N));
+    }
+    return res;
+  }
+
+  static constexpr std::array<int16_t, COUNT * 2> values = make();
+};
+
+template<int N, typename Window>
+struct WindowTableQ15
+{
+  static constexpr std::array<int16_t, N> make()
+  {
+    std::array<int16_t, N> res = {};
+    for(int i=0; i < N; ++i)
+    {
+      res[i] = to_q15(WindowTable<N, Window>::raw(i));
+    }
+    return res;
+  }
+
+  static constexpr std::array<int16_t, N> values = make();
+};
+
+// The biggest magnitude a Q15 value may have so a radix-2
+// butterfly u +/- v * w can't overflow: 32767 / (1 + sqrt(2))
+const int16_t Q15_BUTTERFLY_LIMIT = 13572;
+
+// Shifts all values right until their magnitude is below
+// limit, returns the number of shifts applied.
+inline int q15_normalise(int16_t* data, size_t size, int16_t limit)
+{
+  int max = 0;
+  for(size_t i=0; i < size; ++i)
+  {
+    max = std::max(max, std::abs(int(data[i])));
+  }
+  int shift = 0;
+  while(max > limit)
+  {
+    max >>= 1;
+    ++shift;
+  }
+  if(shift)
+  {
+    for(size_t i=0; i < size; ++i)
+    {
+      data[i] >>= shift;
+    }
+  }
+  return shift;
+}
+
+// In-place radix-2 FFT over N interleaved Q15 complex values,
+// with block floating point scaling: before each stage the
+// block is shifted down just as far as needed to rule out an
+// overflow. Returns the block exponent, the result has
+// to be multiplied by 2^exponent.
+template<int N>
+int fft_radix2_q15(int16_t* data)
+{
+  const auto& bitrev = BitReverseTable<N>::values;
+  const auto& twiddle = TwiddleTableQ15<N, N / 2>::values;
+
+  for(int i=0; i < N; ++i)
+  {
+    const int j = bitrev[i];
+    if(i < j)
+    {
+      std::swap(data[i * 2], data[j * 2]);
+      std::swap(data[i * 2 + 1], data[j * 2 + 1]);
+    }
+  }
+
+  int exponent = 0;
+  for(int len=2, step=N / 2; len <= N; len *= 2, step /= 2)
+  {
+    exponent += q15_normalise(data, N * 2, Q15_BUTTERFLY_LIMIT);
+    const int half = len / 2;
+    for(int i=0; i < N; i += len)
+    {
+      for(int j=0; j < half; ++j)
+      {
+        const int32_t wre = twiddle[j * step * 2];
+        const int32_t wim = twiddle[j * step * 2 + 1];
+        auto u = data + (i + j) * 2;
+        auto v = data + (i + j + half) * 2;
+        const int32_t vre = (v[0] * wre - v[1] * wim) >> 15;
+        const int32_t vim = (v[0] * wim + v[1] * wre) >> 15;
+        const int32_t ure = u[0];
+        const int32_t uim = u[1];
+        v[0] = int16_t(ure - vre);
+        v[1] = int16_t(uim - vim);
+        u[0] = int16_t(ure + vre);
+        u[1] = int16_t(uim + vim);
+      }
+    }
+  }
+  return exponent;
+}
+
+} // end ns detail
+
+struct HannWindow
+{
+  static constexpr std::array<double, 2> COEFFICIENTS = { 0.5, 0.5 };
+};
+
+struct BlackmanHarrisWindow
+{
+  static constexpr std::array<double, 4> COEFFICIENTS = {
+    0.35875, 0.48829, 0.14128, 0.01168
+  };
+};
+
+struct FlatTopWindow
+{
+  static constexpr std::array<double, 5> COEFFICIENTS = {
+    0.21557895, 0.41663158, 0.277263158, 0.083578947, 0.006947368
+  };
+};
@@ -1,11 +1,15 @@
 // Copyright: 2020, Diez B. Roggisch, Berlin, all rights reserved
+#pragma once
 #include "ringbuffer.hh"
-
-#include <esp_dsp.h>
+#include "fft-plan.hh"
+#include "notch-mask.hh"
 
 #include <math.h>
+#include <stdint.h>
+#include <cstring>
 #include <array>
 #include <algorithm>
+#include <type_traits>
 
 namespace detail {
 
@@ -23,18 +27,108 @@ inline void complex_multiply(float are, float aim, float bre, float bim, float&
   cim = im;
 }
 
+// 10 * log10(2), the dB of a factor 2 in power
+const float DB_PER_OCTAVE = 3.01029996f;
+
+constexpr int ilog2(int n)
+{
+  return n <= 1 ? 0 : 1 + ilog2(n / 2);
 }
 
-template<int N, int OVERLAP>
-class FFT
+// Approximates log2 for positive, finite x without
+// any libm calls. The exponent is taken from the float
+// representation, the mantissa by a cubic fitted
+// to log2(1 + t), t in [0, 1), which is exact at both
+// ends. The absolute error is below 1.1e-3, or
+// 0.0035dB when scaled by DB_PER_OCTAVE. Zero yields -127.
+inline float fast_log2(float x)
+{
+  uint32_t bits;
+  std::memcpy(&bits, &x, sizeof(bits));
+  const int exponent = int((bits >> 23) & 0xff) - 127;
+  bits = (bits & 0x007fffff) | 0x3f800000;
+  float mantissa;
+  std::memcpy(&mantissa, &bits, sizeof(mantissa));
+  const auto t = mantissa - 1.0f;
+  return exponent + t * (1.42086454f + t * (-0.57725065f + t * 0.15638611f));
+}
+
+// The inverse of fast_log2, with a cubic fitted to 2^t,
+// t in [0, 1), exact at both ends. The relative error is
+// below 1.5e-4, or 0.0007dB. Results below 2^-126 are flushed
+// to the smallest normal float.
+inline float fast_exp2(float x)
+{
+  x = std::max(x, -126.0f);
+  int exponent = int(x);
+  if(x < exponent)
+  {
+    --exponent;
+  }
+  const auto t = x - exponent;
+  const auto mantissa = 1.0f + t * (0.69592847f + t * (0.22494631f + t * 0.07912522f));
+  uint32_t bits;
+  std::memcpy(&bits, &mantissa, sizeof(bits));
+  bits += uint32_t(exponent) << 23;
+  float res;
+  std::memcpy(&res, &bits, sizeof(res));
+  return res;
+}
+
+// The power of a spectral bin in dB, 10 * log10(|X / 2^log2_scale|^2).
+// The scaling is folded into the logarithm, so no division
+// and no sqrt are needed.
+inline float power_db(float re, float im, int log2_scale)
 {
-  struct complex
+  return DB_PER_OCTAVE * (fast_log2(re * re + im * im) - 2 * log2_scale);
+}
+
+}
+
+// Input modes for the FFT. ComplexInput feeds two real
+// signals as re/im pairs into a full N-point complex
+// transform, and separates their spectra afterwards.
+// IQInput feeds complex baseband samples and keeps
+// the full N-point complex spectrum.
+// RealInput feeds single real samples and computes the
+// spectrum using a N/2-point complex transform plus a
+// split step.
+struct ComplexInput
+{
+  struct sample_t
   {
     float re;
     float im;
   };
+  static constexpr int STRIDE = 2;
+  static constexpr bool SEPARATE = true;
+};
 
-  using rb_t = RingBuffer<complex, OVERLAP * 2>;
+struct IQInput
+{
+  using sample_t = ComplexInput::sample_t;
+  static constexpr int STRIDE = 2;
+  static constexpr bool SEPARATE = false;
+};
+
+struct RealInput
+{
+  using sample_t = float;
+  static constexpr int STRIDE = 1;
+  static constexpr bool SEPARATE = false;
+};
+
+template<int N, int OVERLAP, typename Input=ComplexInput, typename Window=HannWindow, typename Mask=NoMask>
+class FFT
+{
+  static constexpr bool REAL = std::is_same<Input, RealInput>::value;
+  static constexpr int STRIDE = Input::STRIDE;
+  static constexpr int LOG2N = detail::ilog2(N);
+  static_assert(N == 1 << LOG2N, "N must be a power of two");
+  static_assert(!Mask::ENABLED || REAL || Input::SEPARATE, "IQ spectra can't be masked");
+
+  using sample_t = typename Input::sample_t;
+  using rb_t = RingBuffer<sample_t, OVERLAP * 2>;
 
 public:
   int n = N;
@@ -42,83 +136,97 @@ public:
   FFT()
     : _rb_reader(_buffer.reader())
   {
-    auto ret = dsps_fft2r_init_fc32(NULL, N);
-    assert(ret == ESP_OK);
-    dsps_wind_hann_f32(_window.data(), N);
     _complex_input.fill(0.0);
   }
 
   bool feed(float re, float im)
   {
+    static_assert(!REAL, "use feed(float) for real valued input");
     _buffer.append({re, im});
     return _rb_reader.count() >= OVERLAP;
   }
 
+  bool feed(float value)
+  {
+    static_assert(REAL, "use feed(float, float) for complex valued input");
+    _buffer.append(value);
+    return _rb_reader.count() >= OVERLAP;
+  }
+
+  // The input window is kept circular: each hop only
+  // overwrites the OVERLAP oldest samples, and
+  // apply_window reads the window starting from
+  // the write head, which points at the oldest sample.
   void update_input()
   {
-    std::copy(
-      _complex_input.begin() + OVERLAP * 2,
-      _complex_input.end(),
-      _complex_input.begin()
-      );
-    const auto offset = N * 2 - OVERLAP * 2;
     for(size_t i=0; i < OVERLAP; ++i)
     {
-      auto input = _rb_reader.read();
-      _complex_input[offset + i * 2] = input.re;
-      _complex_input[offset + i * 2 + 1] = input.im;
+      store(_input_head * STRIDE, _rb_reader.read());
+      _input_head = (_input_head + 1) % N;
     }
   }
 
   void compute()
   {
     update_input();
+    transform();
+  }
+
+  // Transforms the current input window, without
+  // consuming new samples first.
+  void transform()
+  {
     apply_window();
     auto p = _fft.data();
-    dsps_fft2r_fc32(p, N);
-    // Bit reverse
-    dsps_bit_rev_fc32(p, N);
-    // Convert one complex vector to two complex vectors
-    dsps_cplx2reC_fc32(p, N);
+    if constexpr(REAL)
+    {
+      // The N real samples are interpreted as N/2
+      // complex values (even samples re, odd samples im)
+      detail::fft_radix2<N / 2>(p);
+      split();
+    }
+    else
+    {
+      detail::fft_radix2<N>(p);
+      if constexpr(Input::SEPARATE)
+      {
+        separate();
+      }
+    }
   }
 
   void apply_window()
   {
-    for(auto i=0; i < N; ++i)
+    const auto tail = N - _input_head;
+    apply_window(0, tail, _input_head);
+    apply_window(tail, N, 0);
+  }
+
+  // Turns the bins [first, last) into their power in dB,
+  // 10 * log10(|X / N|^2), in a single pass. The results
+  // are stored from the beginning of the vector, so
+  // fft()[i] is the dB value of bin i.
+  void postprocess(size_t first, size_t last)
+  {
+    const auto& mask = Mask::template values<N>;
+    for(size_t i=first; i < last; ++i)
     {
-      _fft[i * 2] = _complex_input[i * 2] * _window[i];
-      _fft[i * 2 + 1] = _complex_input[i * 2 + 1] * _window[i];
+      // in complex mode both signals share the mask
+      if constexpr(Mask::ENABLED)
+      {
+        if(mask[i & (N / 2 - 1)])
+        {
+          _fft[i] = MASKED_DB;
+          continue;
+        }
+      }
+      _fft[i] = detail::power_db(_fft[i * 2], _fft[i * 2 + 1], LOG2N);
     }
   }
 
   void postprocess()
   {
-    // This processes the data so we get a usable
-    // real-valued spectrum
-
-    // generate spectrum
-    std::transform(
-      _fft.begin(),
-      _fft.end(),
-      _fft.begin(),
-      [](const float v) { return v / N; }
-      );
-
-    for(size_t i=0; i < N; ++i)
-    {
-      const auto re = _fft[i * 2];
-      const auto im = _fft[i * 2 + 1];
-      float cre, cim;
-      // build product of complex value with it's own conjugate
-      detail::complex_conjugate(re, im, cre, cim);
-      detail::complex_multiply(re, im, cre, cim, cre, cim);
-      // now take the norm of the complex number, and store it
-      // back from the beginning of the vector
-      const auto l = sqrtf(cre * cre + cim * cim);
-      //_fft[i] = l;
-      const auto db = 20 * log10(l);
-      _fft[i] = db;
-    }
+    postprocess(0, bins());
   }
 
   size_t size() const
@@ -126,6 +234,17 @@ public:
     return N;
   }
 
+  // The number of complex bins in the spectrum. In real
+  // mode these are the non-negative frequencies [0, N/2).
+  // In complex mode the bins [0, N/2) of the re signal
+  // are followed by the bins [0, N/2) of the im signal.
+  // In IQ mode these are all N bins of the transform, the
+  // negative frequencies in the upper half.
+  size_t bins() const
+  {
+    return REAL ? N / 2 : N;
+  }
+
   template<typename T>
   size_t copy_fft(T& container)
   {
@@ -134,15 +253,123 @@ public:
     return _fft.size();
   }
 
-  const std::array<float, N*2>& fft() const
+  const std::array<float, N * STRIDE>& fft() const
   {
     return _fft;
   }
 
 private:
-  std::array<float, N> _window;
-  std::array<float, N * 2> _complex_input;
-  std::array<float, N * 2> _fft;
+  void store(size_t index, const ComplexInput::sample_t& sample)
+  {
+    _complex_input[index] = sample.re;
+    _complex_input[index + 1] = sample.im;
+  }
+
+  void store(size_t index, float sample)
+  {
+    _complex_input[index] = sample;
+  }
+
+  void apply_window(size_t first, size_t last, size_t input)
+  {
+    const auto& window = detail::WindowTable<N, Window>::values;
+    for(auto i=first; i < last; ++i, ++input)
+    {
+      for(auto j=0; j < STRIDE; ++j)
+      {
+        _fft[i * STRIDE + j] = _complex_input[input * STRIDE + j] * window[i];
+      }
+    }
+  }
+
+  // Untangles the N/2-point transform Z of the even/odd
+  // interleaved real signal into the first N/2 bins
+  // of its N-point spectrum X:
+  //
+  //   E[k] = (Z[k] + conj(Z[N/2 - k])) / 2
+  //   O[k] = (Z[k] - conj(Z[N/2 - k])) / 2j
+  //   X[k] = E[k] + W^k O[k]
+  //   X[N/2 - k] = conj(E[k] - W^k O[k])
+  //
+  // The Nyquist bin would end up packed into X[0].im,
+  // we drop it as nobody looks at it.
+  void split()
+  {
+    const auto half = N / 2;
+    const auto& twiddle = detail::TwiddleTable<N, N / 4 + 1>::values;
+    auto& z = _fft;
+    z[0] = z[0] + z[1];
+    z[1] = 0.0;
+    for(size_t k=1; k <= N / 4; ++k)
+    {
+      const auto mk = half - k;
+      const auto are = z[k * 2];
+      const auto aim = z[k * 2 + 1];
+      const auto bre = z[mk * 2];
+      const auto bim = -z[mk * 2 + 1];
+      const auto ere = (are + bre) * 0.5f;
+      const auto eim = (aim + bim) * 0.5f;
+      const auto ore = (aim - bim) * 0.5f;
+      const auto oim = (bre - are) * 0.5f;
+      float wre, wim;
+      detail::complex_multiply(
+        twiddle[k * 2], twiddle[k * 2 + 1],
+        ore, oim,
+        wre, wim);
+      z[k * 2] = ere + wre;
+      z[k * 2 + 1] = eim + wim;
+      z[mk * 2] = ere - wre;
+      z[mk * 2 + 1] = -(eim - wim);
+    }
+  }
+
+  // Separates the transform Z of x + iy into the first
+  // N/2 bins of X, followed by the first N/2 bins of Y:
+  //
+  //   X[k] = (Z[k] + conj(Z[N - k])) / 2
+  //   Y[k] = (Z[k] - conj(Z[N - k])) / 2i
+  //
+  // The bins k and N/2 - k read and write the same four
+  // slots, so processing them together works in place.
+  void separate()
+  {
+    const auto half = N / 2;
+    auto& z = _fft;
+    const auto separate_bin = [&z](size_t k, float& xre, float& xim, float& yre, float& yim)
+                              {
+                                const auto are = z[k * 2];
+                                const auto aim = z[k * 2 + 1];
+                                const auto bre = z[(N - k) * 2];
+                                const auto bim = -z[(N - k) * 2 + 1];
+                                xre = (are + bre) * 0.5f;
+                                xim = (aim + bim) * 0.5f;
+                                yre = (aim - bim) * 0.5f;
+                                yim = (bre - are) * 0.5f;
+                              };
+    // DC of both signals, the Nyquist bins are dropped
+    z[half * 2] = z[1];
+    z[half * 2 + 1] = 0.0;
+    z[1] = 0.0;
+    for(size_t k=1; k <= N / 4; ++k)
+    {
+      const auto mk = half - k;
+      float xre, xim, yre, yim, mxre, mxim, myre, myim;
+      separate_bin(k, xre, xim, yre, yim);
+      separate_bin(mk, mxre, mxim, myre, myim);
+      z[k * 2] = xre;
+      z[k * 2 + 1] = xim;
+      z[(half + k) * 2] = yre;
+      z[(half + k) * 2 + 1] = yim;
+      z[mk * 2] = mxre;
+      z[mk * 2 + 1] = mxim;
+      z[(half + mk) * 2] = myre;
+      z[(half + mk) * 2 + 1] = myim;
+    }
+  }
+
+  std::array<float, N * STRIDE> _complex_input;
+  std::array<float, N * STRIDE> _fft;
+  size_t _input_head = 0;
 
   rb_t _buffer;
   typename rb_t::Reader _rb_reader;
@@ -0,0 +1,209 @@
+// Copyright: 2020, Diez B. Roggisch, Berlin, all rights reserved
+#pragma once
+#include "fft.hh"
+#include "fft-plan.hh"
+
+#include <math.h>
+#include <stdint.h>
+#include <array>
+#include <algorithm>
+
+// A Q15 fixed point variant of FFT<N, OVERLAP, RealInput>.
+//
+// Samples are stored as int16, mapping +/- full_scale
+// to the Q15 range. Each hop the input window is shifted up
+// to use the full 16 bit range (block floating point), and
+// the transform scales down only as much as needed to not
+// overflow. The resulting block exponent is folded into the
+// logarithm of the postprocessing, so the dB values match
+// the float path.
+template<int N, int OVERLAP, typename Window=HannWindow, typename Mask=NoMask>
+class FixedFFT
+{
+  static constexpr int LOG2N = detail::ilog2(N);
+  static_assert(N == 1 << LOG2N, "N must be a power of two");
+
+  // The split step adds up to two values of magnitude
+  // sqrt(2) times the limit, so we need to leave room for that.
+  static const int16_t SPLIT_LIMIT = 8191;
+
+  using rb_t = RingBuffer<int16_t, OVERLAP * 2>;
+
+public:
+  int n = N;
+
+  FixedFFT(float full_scale=1.0)
+    : _rb_reader(_buffer.reader())
+    , _sample_scale(32767.0f / full_scale)
+  {
+    _input.fill(0);
+    _fft.fill(0);
+    // the dB of the Q15 to full scale mapping and the window's
+    // amplitude correction, relative to the 1/N normalisation
+    _scale_log2 = detail::fast_log2(
+      full_scale / 32767.0f * float(detail::WindowTable<N, Window>::correction)
+      ) - LOG2N;
+  }
+
+  bool feed(float value)
+  {
+    const auto v = std::min(std::max(value * _sample_scale, -32768.0f), 32767.0f);
+    _buffer.append(int16_t(v));
+    return _rb_reader.count() >= OVERLAP;
+  }
+
+  void update_input()
+  {
+    for(size_t i=0; i < OVERLAP; ++i)
+    {
+      _input[_input_head] = _rb_reader.read();
+      _input_head = (_input_head + 1) % N;
+    }
+  }
+
+  void compute()
+  {
+    update_input();
+    transform();
+  }
+
+  void transform()
+  {
+    apply_window();
+    _exponent += detail::fft_radix2_q15<N / 2>(_fft.data());
+    _exponent += detail::q15_normalise(_fft.data(), N, SPLIT_LIMIT);
+    split();
+  }
+
+  void apply_window()
+  {
+    // block floating point: shift the window up as
+    // far as the loudest sample allows
+    int max = 0;
+    for(const auto& v : _input)
+    {
+      max = std::max(max, std::abs(int(v)));
+    }
+    int up = 0;
+    while(max && max < 16384 && up < 15)
+    {
+      max <<= 1;
+      ++up;
+    }
+    _exponent = -up;
+
+    const auto tail = N - _input_head;
+    apply_window(0, tail, _input_head, up);
+    apply_window(tail, N, 0, up);
+  }
+
+  // Turns the bins [first, last) into their power
+  // in dB, same as FFT::postprocess. This happens in
+  // place, so only once per transform.
+  void postprocess(size_t first, size_t last)
+  {
+    const auto scale = 2 * (_exponent + _scale_log2);
+    const auto& mask = Mask::template values<N>;
+    for(size_t i=first; i < last; ++i)
+    {
+      if constexpr(Mask::ENABLED)
+      {
+        if(mask[i])
+        {
+          _db[i] = MASKED_DB;
+          continue;
+        }
+      }
+      const int32_t re = _fft[i * 2];
+      const int32_t im = _fft[i * 2 + 1];
+      const auto power = uint32_t(re * re) + uint32_t(im * im);
+      _db[i] = detail::DB_PER_OCTAVE * (detail::fast_log2(float(power)) + scale);
+    }
+  }
+
+  void postprocess()
+  {
+    postprocess(0, bins());
+  }
+
+  size_t size() const
+  {
+    return N;
+  }
+
+  size_t bins() const
+  {
+    return N / 2;
+  }
+
+  template<typename T>
+  size_t copy_fft(T& container)
+  {
+    container.resize(_db.size());
+    std::copy(_db.begin(), _db.end(), container.begin());
+    return _db.size();
+  }
+
+  const std::array<float, N / 2>& fft() const
+  {
+    return _db;
+  }
+
+private:
+  void apply_window(size_t first, size_t last, size_t input, int up)
+  {
+    const auto& window = detail::WindowTableQ15<N, Window>::values;
+    for(auto i=first; i < last; ++i, ++input)
+    {
+      const int32_t v = int32_t(_input[input]) << up;
+      _fft[i] = int16_t((v * window[i]) >> 15);
+    }
+  }
+
+  // Same split as FFT::split, in Q15
+  void split()
+  {
+    const auto half = N / 2;
+    const auto& twiddle = detail::TwiddleTableQ15<N, N / 4 + 1>::values;
+    auto& z = _fft;
+    z[0] = z[0] + z[1];
+    z[1] = 0;
+    for(size_t k=1; k <= N / 4; ++k)
+    {
+      const auto mk = half - k;
+      const int32_t are = z[k * 2];
+      const int32_t aim = z[k * 2 + 1];
+      const int32_t bre = z[mk * 2];
+      const int32_t bim = -z[mk * 2 + 1];
+      const int32_t ere = (are + bre) >> 1;
+      const int32_t eim = (aim + bim) >> 1;
+      const int32_t ore = (aim - bim) >> 1;
+      const int32_t oim = (bre - are) >> 1;
+      const int32_t wre = (twiddle[k * 2] * ore - twiddle[k * 2 + 1] * oim) >> 15;
+      const int32_t wim = (twiddle[k * 2] * oim + twiddle[k * 2 + 1] * ore) >> 15;
+      z[k * 2] = int16_t(ere + wre);
+      z[k * 2 + 1] = int16_t(eim + wim);
+      z[mk * 2] = int16_t(ere - wre);
+      z[mk * 2 + 1] = int16_t(wim - eim);
+    }
+  }
+
+  std::array<int16_t, N> _input;
+  size_t _input_head = 0;
+  // N/2 complex values, interleaved. The dB of a bin
+  // replaces its two Q15 values, which halves the memory
+  // against the float path.
+  static_assert(sizeof(float) == 2 * sizeof(int16_t), "a dB value must fit a Q15 bin");
+  union
+  {
+    std::array<int16_t, N> _fft;
+    std::array<float, N / 2> _db;
+  };
+
+  int _exponent = 0;
+  float _scale_log2;
+
+  rb_t _buffer;
+  typename rb_t::Reader _rb_reader;
+  float _sample_scale;
+};
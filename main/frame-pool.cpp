@@ -0,0 +1,127 @@
+// Copyright: 2020, Diez B. Roggisch, Berlin, all rights reserved
+#include "frame-pool.hh"
+
+#include <algorithm>
+#include <utility>
+
+FrameRef::FrameRef(const FrameRef& other)
+  : _frame(other._frame)
+{
+  if(_frame)
+  {
+    ++_frame->refs;
+  }
+}
+
+FrameRef::FrameRef(FrameRef&& other)
+  : _frame(other._frame)
+{
+  other._frame = nullptr;
+}
+
+FrameRef& FrameRef::operator=(FrameRef other)
+{
+  std::swap(_frame, other._frame);
+  return *this;
+}
+
+FrameRef::~FrameRef()
+{
+  if(_frame)
+  {
+    // the last reference makes the frame free again
+    --_frame->refs;
+  }
+}
+
+const float* FrameRef::begin() const
+{
+  return _frame->values;
+}
+
+const float* FrameRef::end() const
+{
+  return _frame->values + _frame->size;
+}
+
+size_t FrameRef::size() const
+{
+  return _frame->size;
+}
+
+size_t FrameRef::first_bin() const
+{
+  return _frame->first_bin;
+}
+
+uint32_t FrameRef::sequence() const
+{
+  return _frame->sequence;
+}
+
+float* FrameWriter::data()
+{
+  return _ref._frame->values;
+}
+
+void FrameWriter::set_size(size_t size, size_t first_bin)
+{
+  _ref._frame->size = size;
+  _ref._frame->first_bin = first_bin;
+}
+
+FramePool::FramePool(size_t frame_size, size_t count)
+  : _frame_size(frame_size)
+  , _count(count)
+  , _values(new float[frame_size * count])
+  , _frames(new FrameRef::frame_t[count])
+{
+  std::fill(_values.get(), _values.get() + frame_size * count, 0.0f);
+  for(size_t i=0; i < count; ++i)
+  {
+    auto& frame = _frames[i];
+    frame.refs = 0;
+    frame.sequence = 0;
+    frame.size = 0;
+    frame.first_bin = 0;
+    frame.values = _values.get() + i * frame_size;
+  }
+}
+
+FrameWriter FramePool::acquire()
+{
+  for(size_t i=0; i < _count; ++i)
+  {
+    auto& frame = _frames[i];
+    int free = 0;
+    // claiming the frame takes the first reference
+    if(frame.refs.compare_exchange_strong(free, 1))
+    {
+      return FrameWriter(FrameRef(&frame));
+    }
+  }
+  ++_dropped;
+  return FrameWriter(FrameRef());
+}
+
+FrameRef FramePool::publish(FrameWriter&& writer)
+{
+  if(writer._ref._frame)
+  {
+    writer._ref._frame->sequence = _published++;
+  }
+  return std::move(writer._ref);
+}
+
+size_t FramePool::in_use() const
+{
+  size_t res = 0;
+  for(size_t i=0; i < _count; ++i)
+  {
+    if(_frames[i].refs)
+    {
+      ++res;
+    }
+  }
+  return res;
+}
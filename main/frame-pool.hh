@@ -0,0 +1,128 @@
+// Copyright: 2020, Diez B. Roggisch, Berlin, all rights reserved
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <memory>
+
+class FramePool;
+
+// A published, immutable frame of a pool. Copying a
+// reference only bumps the reference count, the frame
+// returns to the pool when the last reference is gone.
+// References may be passed between tasks.
+class FrameRef
+{
+public:
+  FrameRef() = default;
+  FrameRef(const FrameRef& other);
+  FrameRef(FrameRef&& other);
+  FrameRef& operator=(FrameRef other);
+  ~FrameRef();
+
+  explicit operator bool() const
+  {
+    return _frame;
+  }
+
+  const float* begin() const;
+  const float* end() const;
+  size_t size() const;
+  // the bin of the spectrum the first value belongs to
+  size_t first_bin() const;
+  // counts the published frames
+  uint32_t sequence() const;
+
+private:
+  friend class FramePool;
+  friend class FrameWriter;
+
+  struct frame_t
+  {
+    std::atomic<int> refs;
+    uint32_t sequence;
+    size_t size;
+    size_t first_bin;
+    float* values;
+  };
+
+  explicit FrameRef(frame_t* frame)
+    : _frame(frame)
+  {
+  }
+
+  frame_t* _frame = nullptr;
+};
+
+// A frame acquired from the pool, exclusively owned by the
+// producer until it is published.
+class FrameWriter
+{
+public:
+  FrameWriter(FrameWriter&& other) = default;
+
+  explicit operator bool() const
+  {
+    return bool(_ref);
+  }
+
+  float* data();
+  void set_size(size_t size, size_t first_bin);
+
+private:
+  friend class FramePool;
+
+  explicit FrameWriter(FrameRef&& ref)
+    : _ref(std::move(ref))
+  {
+  }
+
+  FrameRef _ref;
+};
+
+// A fixed number of frames of a fixed size, allocated once.
+//
+// The producer acquires a free frame, fills it and publishes
+// it. From then on it is immutable and can be read by any
+// number of consumers without copying. If all frames are
+// still referenced, the new frame is dropped and counted.
+class FramePool
+{
+public:
+  FramePool(size_t frame_size, size_t count);
+
+  // An empty writer if all frames are in use.
+  FrameWriter acquire();
+  FrameRef publish(FrameWriter&& writer);
+
+  size_t frame_size() const
+  {
+    return _frame_size;
+  }
+
+  size_t count() const
+  {
+    return _count;
+  }
+
+  size_t in_use() const;
+
+  size_t published() const
+  {
+    return _published;
+  }
+
+  size_t dropped() const
+  {
+    return _dropped;
+  }
+
+private:
+  size_t _frame_size;
+  size_t _count;
+  std::unique_ptr<float[]> _values;
+  std::unique_ptr<FrameRef::frame_t[]> _frames;
+  uint32_t _published = 0;
+  size_t _dropped = 0;
+};
@@ -0,0 +1,75 @@
+// Copyright: 2020, Diez B. Roggisch, Berlin, all rights reserved
+#pragma once
+
+#include <stddef.h>
+
+// Decides which hops of an FFT engine actually get
+// transformed.
+//
+// Each complete hop is absorbed into the input window right
+// away, but only transformed on the next call to compute().
+// If another hop completes before that, the pending one
+// is skipped. So a consumer that calls compute() after
+// every fed sample gets every frame (e.g. the streamer),
+// while a consumer that calls it once after draining a
+// backlog only pays for the newest window (e.g. the display).
+template<typename FFT>
+class FrameScheduler
+{
+public:
+  FrameScheduler(FFT& fft)
+    : _fft(fft)
+  {
+  }
+
+  template<typename... Values>
+  void feed(Values... values)
+  {
+    if(_fft.feed(values...))
+    {
+      _fft.update_input();
+      if(_pending)
+      {
+        ++_skipped;
+      }
+      _pending = true;
+    }
+  }
+
+  // Transforms the newest window if there was a
+  // complete hop since the last call.
+  bool compute()
+  {
+    if(!_pending)
+    {
+      return false;
+    }
+    _fft.transform();
+    _pending = false;
+    ++_computed;
+    return true;
+  }
+
+  // Drops a pending hop, e.g. when the engine switched its
+  // size, as it would be transformed on a fresh window.
+  void reset()
+  {
+    _pending = false;
+  }
+
+  size_t computed() const
+  {
+    return _computed;
+  }
+
+  size_t skipped() const
+  {
+    return _skipped;
+  }
+
+private:
+  FFT& _fft;
+  bool _pending = false;
+  size_t _computed = 0;
+  size_t _skipped = 0;
+};
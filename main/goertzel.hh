@@ -0,0 +1,138 @@
+// Copyright: 2020, Diez B. Roggisch, Berlin, all rights reserved
+#pragma once
+#include "fft.hh"
+
+#include <math.h>
+#include <array>
+#include <algorithm>
+
+// A bank of K Goertzel filters, tracking the power
+// at known frequencies, e.g. the harmonics of the motor.
+//
+// To deliver results at hop rate without restarting
+// blocks, the resonators are damped by r = 1 - 4.5 / N.
+// That is an exponential window with about the -3dB
+// bandwidth of an N-point Hann window. Per sample and
+// frequency this costs two multiplications:
+//
+//   s[n] = x[n] + 2r cos(w) s[n-1] - r^2 s[n-2]
+//
+// and the output y = s[n] - r e^(-iw) s[n-1] is only
+// formed once per hop.
+//
+// The interface mirrors the FFT engines, with bin
+// i being the i-th frequency.
+template<int K, int N, int OVERLAP>
+class GoertzelBank
+{
+  static constexpr float R = 1.0f - 4.5f / N;
+
+public:
+  int n = K;
+
+  GoertzelBank()
+  {
+    _s1.fill(0.0);
+    _s2.fill(0.0);
+    _spectrum.fill(0.0);
+    _db.fill(0.0);
+    _coefficient.fill(0.0);
+    _cos.fill(1.0);
+    _sin.fill(0.0);
+    // the steady state gain of a resonator is 1 / (1 - r),
+    // a sinusoid of amplitude A then reads A / 2 like in the FFT
+    _scale_log2 = detail::fast_log2(1.0f - R);
+  }
+
+  void tune(float samplerate, const std::array<float, K>& frequencies)
+  {
+    for(size_t i=0; i < K; ++i)
+    {
+      const auto w = 2 * float(M_PI) * frequencies[i] / samplerate;
+      _cos[i] = cosf(w);
+      _sin[i] = sinf(w);
+      _coefficient[i] = 2 * R * _cos[i];
+    }
+  }
+
+  bool feed(float value)
+  {
+    for(size_t i=0; i < K; ++i)
+    {
+      const auto s = value + _coefficient[i] * _s1[i] - R * R * _s2[i];
+      _s2[i] = _s1[i];
+      _s1[i] = s;
+    }
+    return ++_pending >= OVERLAP;
+  }
+
+  // The samples went into the resonators when they
+  // were fed, we only account for the hop.
+  void update_input()
+  {
+    _pending -= OVERLAP;
+  }
+
+  void transform()
+  {
+    for(size_t i=0; i < K; ++i)
+    {
+      _spectrum[i * 2] = _s1[i] - R * _cos[i] * _s2[i];
+      _spectrum[i * 2 + 1] = R * _sin[i] * _s2[i];
+    }
+  }
+
+  void compute()
+  {
+    update_input();
+    transform();
+  }
+
+  void postprocess(size_t first, size_t last)
+  {
+    for(size_t i=first; i < last; ++i)
+    {
+      _db[i] = detail::power_db(_spectrum[i * 2], _spectrum[i * 2 + 1], 0)
+        + 2 * detail::DB_PER_OCTAVE * _scale_log2;
+    }
+  }
+
+  void postprocess()
+  {
+    postprocess(0, bins());
+  }
+
+  size_t size() const
+  {
+    return K;
+  }
+
+  size_t bins() const
+  {
+    return K;
+  }
+
+  template<typename T>
+  size_t copy_fft(T& container)
+  {
+    container.resize(_db.size());
+    std::copy(_db.begin(), _db.end(), container.begin());
+    return _db.size();
+  }
+
+  const std::array<float, K>& fft() const
+  {
+    return _db;
+  }
+
+private:
+  std::array<float, K> _coefficient;
+  std::array<float, K> _cos;
+  std::array<float, K> _sin;
+  std::array<float, K> _s1;
+  std::array<float, K> _s2;
+  std::array<float, K * 2> _spectrum;
+  std::array<float, K> _db;
+  float _scale_log2;
+  int _pending = 0;
+};
@@ -0,0 +1,120 @@
+// Copyright: 2020, Diez B. Roggisch, Berlin, all rights reserved
+#pragma once
+#include "dc-blocker.hh"
+
+#include <math.h>
+#include <stdint.h>
+#include <array>
+
+// Detects when the grinder runs, from the vibration
+// energy of the raw samples.
+//
+// The samples are DC blocked, squared and summed over a
+// moving window of WINDOW samples. Grinding starts when the
+// level rises above on_db and stops when it falls below
+// off_db, the gap between the two is the hysteresis. As the
+// window is a boxcar, a step in the vibration crosses the
+// thresholds after at most WINDOW samples, so choosing
+// WINDOW as one FFT hop bounds the latency by that.
+//
+// This costs a handful of float operations per sample,
+// so it runs at the full MPU samplerate.
+template<int WINDOW>
+class GrindDetector
+{
+public:
+  enum event_e
+  {
+    NONE,
+    STARTED,
+    STOPPED
+  };
+
+  GrindDetector(float samplerate, float on_db, float off_db, float dc_cutoff=2.0)
+    : _samplerate(samplerate)
+    // the thresholds are compared against the mean power
+    , _on(WINDOW * powf(10.0f, on_db / 10.0f))
+    , _off(WINDOW * powf(10.0f, off_db / 10.0f))
+    , _dc_blocker(samplerate, dc_cutoff)
+  {
+    _history.fill(0.0);
+  }
+
+  event_e feed(float value)
+  {
+    // only the vibration counts, not the bias/drift
+    const auto ac = _dc_blocker.feed(value);
+    const auto power = ac * ac;
+    _sum += power - _history[_head];
+    _history[_head] = power;
+    if(++_head == WINDOW)
+    {
+      _head = 0;
+      // re-sum from scratch so rounding errors
+      // of the running sum can't accumulate
+      _sum = 0.0;
+      for(const auto& p : _history)
+      {
+        _sum += p;
+      }
+    }
+    ++_sample;
+
+    if(!_grinding && _sum > _on)
+    {
+      _grinding = true;
+      _started = _sample;
+      return STARTED;
+    }
+    if(_grinding && _sum < _off)
+    {
+      _grinding = false;
+      _stopped = _sample;
+      return STOPPED;
+    }
+    return NONE;
+  }
+
+  bool grinding() const
+  {
+    return _grinding;
+  }
+
+  // The sample times of the last start and stop, in seconds
+  // since the detector was created.
+  float started() const
+  {
+    return _started / _samplerate;
+  }
+
+  float stopped() const
+  {
+    return _stopped / _samplerate;
+  }
+
+  // The duration of the running grind,
+  // or of the last one when idle.
+  float grind_time() const
+  {
+    return ((_grinding ? _sample : _stopped) - _started) / _samplerate;
+  }
+
+  void reset()
+  {
+    _started = _stopped = _sample;
+  }
+
+private:
+  float _samplerate;
+  float _on, _off;
+  DCBlocker _dc_blocker;
+
+  std::array<float, WINDOW> _history;
+  size_t _head = 0;
+  float _sum = 0.0;
+
+  bool _grinding = false;
+  int64_t _sample = 0;
+  int64_t _started = 0;
+  int64_t _stopped = 0;
+};
@@ -3,6 +3,20 @@
 #include "mpu6050.hh"
 #include "madgwick.hh"
 #include "fft.hh"
+#include "fft-dispatcher.hh"
+#include "sdft.hh"
+#include "fixed-fft.hh"
+#include "frame-scheduler.hh"
+#include "multi-axis-fft.hh"
+#include "decimator.hh"
+#include "zoom-fft.hh"
+#include "goertzel.hh"
+#include "grind-detector.hh"
+#include "dc-blocker.hh"
+#include "stft.hh"
+#include "noise-floor.hh"
+#include "rpm-estimator.hh"
+#include "baseline.hh"
 #include "ringbuffer.hh"
 #include "io-buttons.hh"
 
@@ -11,6 +25,10 @@
 #include "streamer.hh"
 #endif
 
+#ifdef CONFIG_COFFEE_CLOCK_BENCHMARK
+#include "benchmark.hh"
+#endif
+
 #include "fft-display.hh"
 
 #include <freertos/FreeRTOS.h>
@@ -22,7 +40,10 @@
 #include <math.h>
 #include <array>
 #include <vector>
+#include <string>
+#include <algorithm>
 #include <sstream>
+#include <iomanip>
 
 extern "C" void app_main();
 
@@ -36,24 +57,73 @@ namespace {
 
 const int MAINLOOP_WAIT = 16; // 60fps
 const int WIFI_WAIT = 500;
+// The DC blocker removes the drift of the integrated
+// angle, so we only need to skip the DC bin itself.
+const int FFT_FIRST_BIN = 1;
+// corner frequency of the DC blockers in Hz
+const float DC_CORNER = CONFIG_COFFEE_CLOCK_DC_CORNER / 10.0;
+#ifdef CONFIG_COFFEE_CLOCK_FIXED_POINT_FFT
+// the angle in rad which maps to Q15 full scale
+const float FIXED_POINT_FULL_SCALE = CONFIG_COFFEE_CLOCK_FIXED_POINT_FULL_SCALE / 180.0 * M_PI;
+#endif
+#ifdef CONFIG_COFFEE_CLOCK_FFT_DISPATCH
+// the most bins we display, those of the largest FFT
+const int DISPLAY_SIZE = 1024 / 2;
+#else
+// the most bins we display, those of the zoom FFT
+const int DISPLAY_SIZE = 256;
+#endif
+// big enough for all spectra we average, besides the
+// displayed ones the three axes of the multi axis FFT
+const int AVERAGER_SIZE = std::max(DISPLAY_SIZE, 3 * 256 / 2);
+// the frames of the spectra in flight, one is held
+// by the streamer until it is fetched
+const int FRAME_POOL_SIZE = 4;
+#ifdef CONFIG_COFFEE_CLOCK_GOERTZEL
+// how many motor harmonics the Goertzel bank tracks, up
+// to eight, but only those below the Nyquist frequency
+// of the decimated samples
+const int GOERTZEL_HARMONICS = std::min(
+  8,
+  (NOMINAL_SAMPLERATE - 1) / (2 * CONFIG_COFFEE_CLOCK_DECIMATION * CONFIG_COFFEE_CLOCK_MOTOR_FREQUENCY)
+  );
+static_assert(GOERTZEL_HARMONICS > 0, "the motor frequency is above the Nyquist frequency");
+#endif
+#ifdef CONFIG_COFFEE_CLOCK_GRINDER_PROTOTYPE
+using GrinderModel = PrototypeGrinderModel;
+#else
+using GrinderModel = NoGrinderModel;
+#endif
+// the resonances of the grinder are masked
+// in the spectra at the FFT samplerate
+using Mask = NotchMask<NOMINAL_SAMPLERATE, CONFIG_COFFEE_CLOCK_DECIMATION, GrinderModel>;
+#ifdef CONFIG_COFFEE_CLOCK_MULTI_AXIS_FFT
+struct gyro_axes_t
+{
+  float x, y, z;
+};
+#endif
 const auto SDA = gpio_num_t(19);
 const auto SCL = gpio_num_t(20);
 
 class GyroAxisDisplay
 {
 public:
-  GyroAxisDisplay(const char* name, int x, int y, int radius, float offset)
+  GyroAxisDisplay(const char* name, int x, int y, int radius, float offset, float samplerate)
     : _name(name)
     , _x(x)
     , _y(y)
     , _radius(radius)
     , _offset(offset)
+    , _dc_blocker(samplerate, DC_CORNER)
   {
   }
 
+  // The rate is DC blocked before we integrate, so the
+  // gyro bias can't make the angle drift away.
   void update(float gyro, float elapsed_seconds)
   {
-    _gyro_accu += gyro * elapsed_seconds;
+    _gyro_accu += _dc_blocker.feed(gyro) * elapsed_seconds;
   }
 
   void reset()
@@ -94,6 +164,7 @@ private:
   int _x, _y, _radius;
   float _offset;
   float _gyro_accu = 0.0;
+  DCBlocker _dc_blocker;
 };
 
 void main_task(void*)
@@ -104,16 +175,95 @@ void main_task(void*)
   #else
   Display display;
   auto test_sprite = BufferedSprite(display.width() - 4, 28, nullptr, 0xff);
+  // the HUD stays put, only the waterfall below it
+  // scrolls
+  display.set_scroll_area(test_sprite.height() + 4);
+  std::string hud_text;
+  #endif
+
+  #ifdef CONFIG_COFFEE_CLOCK_BENCHMARK
+  run_benchmarks();
   #endif
 
-  using FFT = FFT<256, 16>;
   auto rb = new RingBuffer<float, 2000>();
+  #ifdef CONFIG_COFFEE_CLOCK_MULTI_AXIS_FFT
+  // the raw gyro rates of all axes for the spectra
+  auto axes_rb = new RingBuffer<gyro_axes_t, 500>();
+  auto axes_reader = axes_rb->reader();
+  #endif
 
+  using Decimator = Decimator<CONFIG_COFFEE_CLOCK_DECIMATION, CONFIG_COFFEE_CLOCK_DECIMATION_TAPS>;
+  // the zoom FFT replaces the main FFT on the display
+  #ifndef CONFIG_COFFEE_CLOCK_ZOOM_FFT
+  #if defined(CONFIG_COFFEE_CLOCK_MULTI_AXIS_FFT)
+  using FFT = MultiAxisFFT<256, 16, HannWindow, Mask>;
+  #elif defined(CONFIG_COFFEE_CLOCK_SLIDING_DFT)
+  using FFT = SlidingDFT<256, 16, FFT_FIRST_BIN, 256 / 2, Mask>;
+  #elif defined(CONFIG_COFFEE_CLOCK_FIXED_POINT_FFT)
+  using FFT = FixedFFT<256, 16, HannWindow, Mask>;
+  #elif defined(CONFIG_COFFEE_CLOCK_GOERTZEL)
+  using FFT = GoertzelBank<GOERTZEL_HARMONICS, 256, 16>;
+  #elif defined(CONFIG_COFFEE_CLOCK_FFT_DISPATCH)
+  // the hop is always 1/16th of the size
+  using FFT = FFTDispatcher<
+    Mask,
+    FFTConfig<128, 8>,
+    FFTConfig<256, 16>,
+    FFTConfig<512, 32>,
+    FFTConfig<1024, 64>
+    >;
+  #else
+  using FFT = FFT<256, 16, RealInput, HannWindow, Mask>;
+  #endif
+  #ifdef CONFIG_COFFEE_CLOCK_FIXED_POINT_FFT
+  auto fft = new FFT(FIXED_POINT_FULL_SCALE);
+  #else
   auto fft = new FFT();
+  #endif
+  #ifdef CONFIG_COFFEE_CLOCK_FFT_DISPATCH
+  fft->select_size(256);
+  #endif
+  auto fft_scheduler = FrameScheduler<FFT>(*fft);
+  #ifdef CONFIG_COFFEE_CLOCK_MULTI_AXIS_FFT
+  std::array<Decimator, 3> axes_decimators;
+  #else
+  Decimator decimator;
+  #endif
+  #endif
 
 
 
   auto fft_display = new FFTDisplay<135>;
+  #ifdef CONFIG_COFFEE_CLOCK_MULTI_AXIS_FFT
+  fft_display->select_axis(CONFIG_COFFEE_CLOCK_DISPLAY_AXIS);
+  #endif
+  using STFT = STFTProducer<AVERAGER_SIZE>;
+  auto stft = new STFT(
+    #ifdef CONFIG_COFFEE_CLOCK_WELCH_AVERAGING
+    STFT::Averager::WELCH,
+    #else
+    STFT::Averager::EXPONENTIAL,
+    #endif
+    CONFIG_COFFEE_CLOCK_AVERAGING_FRAMES,
+    FRAME_POOL_SIZE
+    );
+  ESP_LOGI(
+    "main", "frame pool: %i frames of %i bins, %i bytes",
+    stft->pool().count(), stft->pool().frame_size(),
+    stft->pool().count() * stft->pool().frame_size() * sizeof(float));
+  #ifdef CONFIG_COFFEE_CLOCK_RPM
+  RPMEstimator<> rpm_estimator;
+  #endif
+  #if defined(CONFIG_COFFEE_CLOCK_STREAM_DATA) && defined(CONFIG_COFFEE_CLOCK_MULTI_AXIS_FFT)
+  // the spectra of all axes, in copy_fft layout
+  std::vector<float> fft_frame;
+  #endif
+  #ifdef CONFIG_COFFEE_CLOCK_NOISE_FLOOR
+  auto noise_floor = new NoiseFloor<DISPLAY_SIZE>(
+    CONFIG_COFFEE_CLOCK_NOISE_FLOOR_FRAMES,
+    CONFIG_COFFEE_CLOCK_NOISE_THRESHOLD
+    );
+  #endif
 
   I2CHost i2c(I2C_NUM_0, SDA, SCL);
 
@@ -137,10 +287,148 @@ void main_task(void*)
 
   const auto mpu_samplerate = mpu.samplerate();
   const auto elapsed_seconds = 1.0 / mpu_samplerate;
+  const auto fft_samplerate = mpu_samplerate / Decimator::factor();
+  ESP_LOGI("main", "FFT samplerate: %f", fft_samplerate);
+  #ifdef CONFIG_COFFEE_CLOCK_RPM
+  rpm_estimator.set_bin_spacing(fft_samplerate / fft->size());
+  #endif
+  if(Mask::ENABLED && int(mpu_samplerate) != NOMINAL_SAMPLERATE)
+  {
+    ESP_LOGW("main", "notch mask assumes %iHz, the notches are off", NOMINAL_SAMPLERATE);
+  }
+  #ifdef CONFIG_COFFEE_CLOCK_GOERTZEL
+  std::array<float, GOERTZEL_HARMONICS> harmonics;
+  for(size_t i=0; i < harmonics.size(); ++i)
+  {
+    harmonics[i] = (i + 1) * CONFIG_COFFEE_CLOCK_MOTOR_FREQUENCY;
+  }
+  fft->tune(fft_samplerate, harmonics);
+  #endif
+  #ifdef CONFIG_COFFEE_CLOCK_ZOOM_FFT
+  const int ZOOM = CONFIG_COFFEE_CLOCK_ZOOM_DECIMATION;
+  using ZoomFFT = ZoomFFT<256, 16, ZOOM, 8 * ZOOM - 1>;
+  auto zoom_fft = new ZoomFFT(mpu_samplerate, CONFIG_COFFEE_CLOCK_ZOOM_CENTRE);
+  auto zoom_scheduler = FrameScheduler<ZoomFFT>(*zoom_fft);
+  ESP_LOGI("main", "zoom FFT bin spacing: %f", zoom_fft->bin_spacing());
+  auto& display_scheduler = zoom_scheduler;
+  #elif !defined(CONFIG_COFFEE_CLOCK_STREAM_DATA)
+  auto& display_scheduler = fft_scheduler;
+  #endif
+  #ifdef CONFIG_COFFEE_CLOCK_BASELINE
+  // the baselines are stored per samplerate and bin range,
+  // and loaded once frames of them arrive
+  #ifdef CONFIG_COFFEE_CLOCK_ZOOM_FFT
+  auto baseline = new BaselineSpectrum<AVERAGER_SIZE>(mpu_samplerate / ZOOM);
+  #else
+  auto baseline = new BaselineSpectrum<AVERAGER_SIZE>(fft_samplerate);
+  #endif
+  #endif
   #ifdef CONFIG_COFFEE_CLOCK_FILTER_IMU
   MadgwickAHRS mpu_filter(mpu_samplerate);
   #endif
-  GyroAxisDisplay z_axis("Z", 64, 32, 12, .7);
+  GyroAxisDisplay z_axis("Z", 64, 32, 12, .7, mpu_samplerate);
+  #ifdef CONFIG_COFFEE_CLOCK_MULTI_AXIS_FFT
+  // the raw rates carry the gyro bias
+  std::array<DCBlocker, 3> axes_dc_blockers = {
+    DCBlocker(mpu_samplerate, DC_CORNER),
+    DCBlocker(mpu_samplerate, DC_CORNER),
+    DCBlocker(mpu_samplerate, DC_CORNER)
+  };
+  #endif
+  // the window is one FFT hop at the MPU samplerate,
+  // which bounds the detection latency
+  using GrindDetector = GrindDetector<16 * Decimator::factor()>;
+  GrindDetector grind_detector(
+    mpu_samplerate,
+    CONFIG_COFFEE_CLOCK_GRIND_ON_DB,
+    CONFIG_COFFEE_CLOCK_GRIND_OFF_DB
+    );
+
+  // hands a published frame to all consumers, none
+  // of them copies it
+  const auto consume_frame = [&](const FrameRef& frame)
+                             {
+                               #ifdef CONFIG_COFFEE_CLOCK_STREAM_DATA
+                               streamer->deliver_frame(frame);
+                               #elif defined(CONFIG_COFFEE_CLOCK_NOISE_FLOOR)
+                               noise_floor->update(frame.begin(), frame.end());
+                               fft_display->update(noise_floor->begin(), noise_floor->end());
+                               #else
+                               fft_display->update(frame.begin(), frame.end());
+                               #endif
+                               #ifdef CONFIG_COFFEE_CLOCK_RPM
+                               #if defined(CONFIG_COFFEE_CLOCK_STREAM_DATA) && defined(CONFIG_COFFEE_CLOCK_MULTI_AXIS_FFT)
+                               // the streamed frames hold all axes
+                               const auto spectrum = frame.begin() + CONFIG_COFFEE_CLOCK_DISPLAY_AXIS * fft->bins();
+                               rpm_estimator.update(spectrum, spectrum + fft->bins(), 0);
+                               #else
+                               rpm_estimator.update(frame.begin(), frame.end(), frame.first_bin());
+                               #endif
+                               #ifdef CONFIG_COFFEE_CLOCK_STREAM_DATA
+                               streamer->deliver_rpm(rpm_estimator.valid() ? rpm_estimator.rpm() : 0.0f);
+                               #endif
+                               #endif
+                               #ifdef CONFIG_COFFEE_CLOCK_BASELINE
+                               if(grind_detector.grinding())
+                               {
+                                 baseline->update(frame.begin(), frame.end(), frame.first_bin());
+                                 #ifdef CONFIG_COFFEE_CLOCK_STREAM_DATA
+                                 streamer->deliver_anomaly(baseline->valid() ? baseline->score() : 0.0f);
+                                 #endif
+                               }
+                               #endif
+                             };
+
+  #ifdef CONFIG_COFFEE_CLOCK_FFT_DISPATCH
+  // the consumers of the spectra adapt to new sizes
+  // by themselves, but the state carried over from
+  // the old size is meaningless for the new one
+  const auto fft_switched = [&]()
+                            {
+                              ESP_LOGI("main", "FFT size: %i, overlap: %i", fft->size(), fft->overlap());
+                              fft_scheduler.reset();
+                              stft->reset();
+                              #ifdef CONFIG_COFFEE_CLOCK_NOISE_FLOOR
+                              noise_floor->reset();
+                              #endif
+                              #ifdef CONFIG_COFFEE_CLOCK_RPM
+                              rpm_estimator.set_bin_spacing(fft_samplerate / fft->size());
+                              #endif
+                            };
+  #endif
+
+  #ifndef CONFIG_COFFEE_CLOCK_ZOOM_FFT
+  // feeds one sample into the spectral pipeline
+  const auto feed_fft = [&](auto... values)
+                        {
+                          fft_scheduler.feed(values...);
+                          #ifdef CONFIG_COFFEE_CLOCK_STREAM_DATA
+                          // the streamer wants every frame, but
+                          // only gets to see the averages
+                          if(fft_scheduler.compute())
+                          {
+                            fft->postprocess();
+                            #ifdef CONFIG_COFFEE_CLOCK_MULTI_AXIS_FFT
+                            fft->copy_fft(fft_frame);
+                            const auto frame = stft->publish(fft_frame.begin(), fft_frame.end(), 0);
+                            #else
+                            const auto frame = stft->publish(
+                              fft->fft().begin(), fft->fft().begin() + fft->bins(), 0);
+                            #endif
+                            if(frame)
+                            {
+                              consume_frame(frame);
+                              if(frame.sequence() % 1000 == 0)
+                              {
+                                ESP_LOGI(
+                                  "main", "frames published: %i dropped: %i",
+                                  stft->pool().published(), stft->pool().dropped());
+                              }
+                            }
+                          }
+                          #endif
+                        };
+  #endif
 
   EventGroupHandle_t button_events = xEventGroupCreate();
   assert(button_events);
@@ -148,6 +436,35 @@ void main_task(void*)
 
   auto display_reader = rb->reader();
 
+  #ifdef CONFIG_COFFEE_CLOCK_BASELINE
+  // the baseline is written to flash from the main loop,
+  // not while we drain the MPU FIFO
+  bool baseline_save_pending = false;
+  #endif
+  // the thresholds apply to the gyro rate,
+  // regardless of what we display
+  const auto detect_grind = [&](float rate)
+                            {
+                              switch(grind_detector.feed(rate))
+                              {
+                              case GrindDetector::STARTED:
+                                ESP_LOGI("main", "grinding started at %fs", grind_detector.started());
+                                z_axis.reset();
+                                break;
+                              case GrindDetector::STOPPED:
+                                ESP_LOGI(
+                                  "main", "grinding stopped at %fs after %fs",
+                                  grind_detector.stopped(), grind_detector.grind_time());
+                                #ifdef CONFIG_COFFEE_CLOCK_BASELINE
+                                // once per grind, not per frame
+                                baseline_save_pending = true;
+                                #endif
+                                break;
+                              default:
+                                break;
+                              }
+                            };
+
   auto timestamp = esp_timer_get_time();
   size_t max_datagram_count = 0;
   bool running = true;
@@ -155,8 +472,12 @@ void main_task(void*)
   {
     const auto datagram_count = mpu.consume_fifo(
       #ifdef CONFIG_COFFEE_CLOCK_FILTER_IMU
-      [rb, &mpu_filter](const MPU6050::gyro_data_t& entry)
+      [&](const MPU6050::gyro_data_t& entry)
       {
+        detect_grind(entry.gyro[0]);
+        #ifdef CONFIG_COFFEE_CLOCK_MULTI_AXIS_FFT
+        axes_rb->append({entry.gyro[0], entry.gyro[1], entry.gyro[2]});
+        #endif
         mpu_filter.update_imu(
           entry.gyro[0],
           entry.gyro[1],
@@ -169,13 +490,21 @@ void main_task(void*)
         rb->append(x);
       }
       #else
-      [rb](const MPU6050::gyro_data_t& entry)
+      [&](const MPU6050::gyro_data_t& entry)
       {
+        detect_grind(entry.gyro[0]);
         rb->append(entry.gyro[0]);
       }
       #endif
       );
     max_datagram_count = std::max(datagram_count, max_datagram_count);
+    #ifdef CONFIG_COFFEE_CLOCK_BASELINE
+    if(baseline_save_pending)
+    {
+      baseline->save();
+      baseline_save_pending = false;
+    }
+    #endif
     display_reader.consume(
       [&](const float& v)
       {
@@ -184,37 +513,108 @@ void main_task(void*)
         #ifdef CONFIG_COFFEE_CLOCK_STREAM_DATA
         streamer->feed(rad);
         #endif
-        if(fft->feed(rad, rad))
+        #ifdef CONFIG_COFFEE_CLOCK_ZOOM_FFT
+        zoom_scheduler.feed(rad);
+        #elif !defined(CONFIG_COFFEE_CLOCK_MULTI_AXIS_FFT)
+        float decimated;
+        if(decimator.feed(rad, decimated))
         {
-          fft->compute();
-          fft->postprocess();
-          #ifdef CONFIG_COFFEE_CLOCK_STREAM_DATA
-          streamer->deliver_fft(fft);
-          #else
-          fft_display->update(
-            // We filter out the lowest frequency bins
-            // because they contain DC and the drift.
-            // The value is just experience, I need to dig
-            // down deeper to understand that.
-            fft->fft().begin() + 12,
-            // This would go to n / 2, as we throw away
-            // the negative frequencies. But this use-case
-            // doesen't warrant those higher frequencies.
-            fft->fft().begin() + fft->n / 2
-            );
-          #endif
+          feed_fft(decimated);
         }
+        #endif
       }
       );
+    #ifdef CONFIG_COFFEE_CLOCK_MULTI_AXIS_FFT
+    axes_reader.consume(
+      [&](const gyro_axes_t& axes)
+      {
+        float x, y, z;
+        // all decimators run in lockstep
+        const auto ready = axes_decimators[0].feed(axes_dc_blockers[0].feed(axes.x), x);
+        axes_decimators[1].feed(axes_dc_blockers[1].feed(axes.y), y);
+        axes_decimators[2].feed(axes_dc_blockers[2].feed(axes.z), z);
+        if(ready)
+        {
+          feed_fft(x, y, z);
+        }
+      }
+      );
+    #endif
+    #ifndef CONFIG_COFFEE_CLOCK_STREAM_DATA
+    // the display only shows the newest spectrum, so
+    // when we drained a backlog all older hops are skipped
+    #ifdef CONFIG_COFFEE_CLOCK_ZOOM_FFT
+    if(zoom_scheduler.compute())
+    {
+      zoom_fft->postprocess();
+      if(const auto frame = stft->publish(zoom_fft->fft().begin(), zoom_fft->fft().end(), 0))
+      {
+        consume_frame(frame);
+      }
+    }
+    #else
+    if(fft_scheduler.compute())
+    {
+      #ifdef CONFIG_COFFEE_CLOCK_GOERTZEL
+      // there are no DC bins to skip
+      const size_t display_first = 0;
+      #else
+      const size_t display_first = FFT_FIRST_BIN;
+      #endif
+      // This would go to n, as we throw away
+      // the negative frequencies. But this use-case
+      // doesen't warrant those higher frequencies.
+      const size_t display_last = fft->bins();
+      fft->postprocess(display_first, display_last);
+      #ifdef CONFIG_COFFEE_CLOCK_MULTI_AXIS_FFT
+      const auto spectrum = fft->fft(FFT::axis_e(fft_display->axis()));
+      #else
+      const auto spectrum = fft->fft().begin();
+      #endif
+      const auto frame = stft->publish(
+        spectrum + display_first, spectrum + display_last, display_first);
+      if(frame)
+      {
+        consume_frame(frame);
+      }
+    }
+    #endif // CONFIG_COFFEE_CLOCK_ZOOM_FFT
+    #endif
+    #if defined(CONFIG_COFFEE_CLOCK_FFT_DISPATCH) && defined(CONFIG_COFFEE_CLOCK_STREAM_DATA)
+    if(const auto size = streamer->take_fft_size_request())
+    {
+      if(fft->select_size(size))
+      {
+        fft_switched();
+      }
+      else
+      {
+        ESP_LOGW("main", "no FFT of size %i", size);
+      }
+    }
+    #endif
     const auto buttons = xEventGroupGetBits(button_events);
     if(buttons & LEFT_PIN_ISR_FLAG)
     {
       ESP_LOGI("main", "left button pressed");
       z_axis.reset();
+      grind_detector.reset();
     }
     if(buttons & RIGHT_PIN_ISR_FLAG)
     {
       ESP_LOGI("main", "right button pressed");
+      #ifdef CONFIG_COFFEE_CLOCK_FFT_DISPATCH
+      fft->next();
+      fft_switched();
+      #elif defined(CONFIG_COFFEE_CLOCK_MULTI_AXIS_FFT) && !defined(CONFIG_COFFEE_CLOCK_STREAM_DATA)
+      // the averages of the old axis don't apply
+      fft_display->select_axis((fft_display->axis() + 1) % 3);
+      stft->reset();
+      #ifdef CONFIG_COFFEE_CLOCK_NOISE_FLOOR
+      noise_floor->reset();
+      #endif
+      ESP_LOGI("main", "showing axis %i", fft_display->axis());
+      #endif
     }
     if(buttons & DOWN_PIN_ISR_FLAG)
     {
@@ -237,22 +637,42 @@ void main_task(void*)
       const auto now = esp_timer_get_time();
       const float fps = 1.0 / (float(now - timestamp) / 1000000.0);
       timestamp = now;
-      ESP_LOGI("main", "fps: %f, rad: %f, max datagram count: %i", fps, z_axis.rad(), max_datagram_count);
-      auto ds = display.sprite();
-      test_sprite.restore(ds);
+      ESP_LOGI(
+        "main", "fps: %f, rad: %f, max datagram count: %i, fft computed: %i skipped: %i, frames published: %i dropped: %i, transfer: %ius %i bytes, max fps: %f",
+        fps, z_axis.rad(), max_datagram_count, display_scheduler.computed(), display_scheduler.skipped(),
+        stft->pool().published(), stft->pool().dropped(), int(display.transfer_time()),
+        int(display.transfer_size()), 1000000.0 / std::max(display.transfer_time(), uint32_t(1)));
 
       // append a new line with the curent FFT
       // readings.
       display.vscroll();
       fft_display->render(display, 0, display.height() - 1);
 
-      const auto rad = z_axis.rad();
       std::stringstream ss;
-      ss << rad;
-      test_sprite.fill(0x00);
-      display.render_text(test_sprite, ss.str().c_str(), 8, 28 - 2, 1, 0);
-
-      test_sprite.blit(ds, 2, 2);
+      ss << std::fixed << std::setprecision(1) << grind_detector.grind_time() << "s";
+      #ifdef CONFIG_COFFEE_CLOCK_RPM
+      if(rpm_estimator.valid())
+      {
+        ss << " " << int(rpm_estimator.rpm()) << "rpm";
+      }
+      #endif
+      #ifdef CONFIG_COFFEE_CLOCK_BASELINE
+      if(baseline->valid())
+      {
+        ss << " " << std::setprecision(1) << baseline->score() << "dB";
+      }
+      #endif
+      // only touch the HUD if the text changed, so its
+      // rows aren't transmitted again
+      if(ss.str() != hud_text)
+      {
+        hud_text = ss.str();
+        auto ds = display.sprite();
+        test_sprite.restore(ds);
+        test_sprite.fill(0x00);
+        display.render_text(test_sprite, hud_text.c_str(), 8, 28 - 2, 1, 0);
+        test_sprite.blit(ds, 2, 2);
+      }
       display.update();
     }
     #endif // not(CONFIG_COFFEE_CLOCK_STREAM_DATA)
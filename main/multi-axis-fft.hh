@@ -0,0 +1,107 @@
+// Copyright: 2020, Diez B. Roggisch, Berlin, all rights reserved
+#pragma once
+#include "fft.hh"
+
+#include <array>
+#include <algorithm>
+
+// Spectra for all three gyro axes at the cost of two
+// transforms: X and Y are fed as re/im of one complex FFT
+// and separated by conjugate symmetry, Z goes through
+// the real-input FFT, which is half the size.
+template<int N, int OVERLAP, typename Window=HannWindow, typename Mask=NoMask>
+class MultiAxisFFT
+{
+public:
+  enum axis_e
+  {
+    X,
+    Y,
+    Z
+  };
+
+  int n = N;
+
+  bool feed(float x, float y, float z)
+  {
+    _z.feed(z);
+    return _xy.feed(x, y);
+  }
+
+  void update_input()
+  {
+    _xy.update_input();
+    _z.update_input();
+  }
+
+  void transform()
+  {
+    _xy.transform();
+    _z.transform();
+  }
+
+  void compute()
+  {
+    update_input();
+    transform();
+  }
+
+  // Converts the bins [first, last) of all axes to dB.
+  void postprocess(size_t first, size_t last)
+  {
+    // X has to come first, as its results are written over
+    // the complex bins of X, while those of Y are written
+    // behind them
+    _xy.postprocess(first, last);
+    _xy.postprocess(N / 2 + first, N / 2 + last);
+    _z.postprocess(first, last);
+  }
+
+  void postprocess()
+  {
+    postprocess(0, bins());
+  }
+
+  size_t size() const
+  {
+    return N;
+  }
+
+  size_t bins() const
+  {
+    return N / 2;
+  }
+
+  // The spectrum of the given axis, bins() dB values
+  // after postprocessing.
+  const float* fft(axis_e axis) const
+  {
+    switch(axis)
+    {
+    case X:
+      return _xy.fft().data();
+    case Y:
+      return _xy.fft().data() + N / 2;
+    case Z:
+    default:
+      return _z.fft().data();
+    }
+  }
+
+  // Copies the spectra of X, Y and Z one after the other.
+  template<typename T>
+  size_t copy_fft(T& container)
+  {
+    container.resize(bins() * 3);
+    auto out = container.begin();
+    for(const auto axis : { X, Y, Z })
+    {
+      out = std::copy(fft(axis), fft(axis) + bins(), out);
+    }
+    return container.size();
+  }
+
+private:
+  FFT<N, OVERLAP, ComplexInput, Window, Mask> _xy;
+  FFT<N, OVERLAP, RealInput, Window, Mask> _z;
+};
@@ -0,0 +1,120 @@
+// Copyright: 2020, Diez B. Roggisch, Berlin, all rights reserved
+#pragma once
+#include "notch-mask.hh"
+
+#include <array>
+#include <algorithm>
+
+// Tracks the noise floor of each bin by minimum statistics:
+// the floor is the smallest value a bin took over the last
+// `frames` (smoothed) spectra. Signals come and go, while the
+// noise is always there, so unless a tone persists for the
+// whole window, the minimum is the noise.
+//
+// The window is split into SUBWINDOWS parts, and only their
+// minima are kept. So the memory is fixed, and the update is
+// O(bins) per frame, plus O(bins * SUBWINDOWS) whenever a
+// part is complete.
+//
+// Besides the floor, the values exceeding it by more than
+// threshold_db are provided, with everything below clamped
+// to zero. The minimum of a smoothed spectrum lies a few dB
+// below its mean, the threshold has to cover that.
+template<int SIZE, int SUBWINDOWS=8>
+class NoiseFloor
+{
+  // an initial minimum any spectrum is below
+  static constexpr float UNSEEN = 1000.0;
+
+public:
+  NoiseFloor(int frames, float threshold_db)
+    : _subwindow_frames(std::max(frames / SUBWINDOWS, 1))
+    , _threshold(threshold_db)
+  {
+    _floor.fill(0.0);
+    _above.fill(0.0);
+    reset();
+  }
+
+  template<typename T>
+  void update(T begin, T end)
+  {
+    const auto size = std::min(size_t(end - begin), size_t(SIZE));
+    if(size != _size)
+    {
+      reset();
+      _size = size;
+    }
+    for(size_t i=0; i < size; ++i, ++begin)
+    {
+      const float value = *begin;
+      _current[i] = std::min(_current[i], value);
+      _floor[i] = std::min(_current[i], _window_min[i]);
+      // masked bins stay masked for the display
+      _above[i] = value <= MASKED_DB ? MASKED_DB : std::max(value - _floor[i] - _threshold, 0.0f);
+    }
+    if(++_frame == _subwindow_frames)
+    {
+      _frame = 0;
+      rotate();
+    }
+  }
+
+  void reset()
+  {
+    for(auto& minima : _minima)
+    {
+      minima.fill(UNSEEN);
+    }
+    _current.fill(UNSEEN);
+    _window_min.fill(UNSEEN);
+    _frame = 0;
+    _subwindow = 0;
+  }
+
+  // The floor in dB for each bin of the last update.
+  const float* floor() const
+  {
+    return _floor.data();
+  }
+
+  // The dB above the floor and threshold.
+  const float* begin() const
+  {
+    return _above.data();
+  }
+
+  const float* end() const
+  {
+    return _above.data() + _size;
+  }
+
+private:
+  // Stores the completed part, drops the oldest one,
+  // and recomputes the minimum over the stored parts.
+  void rotate()
+  {
+    _minima[_subwindow] = _current;
+    _subwindow = (_subwindow + 1) % SUBWINDOWS;
+    _current.fill(UNSEEN);
+    _window_min = _minima[0];
+    for(size_t s=1; s < SUBWINDOWS; ++s)
+    {
+      for(size_t i=0; i < _size; ++i)
+      {
+        _window_min[i] = std::min(_window_min[i], _minima[s][i]);
+      }
+    }
+  }
+
+  int _subwindow_frames;
+  float _threshold;
+  int _frame;
+  size_t _subwindow;
+  size_t _size = 0;
+  std::array<std::array<float, SIZE>, SUBWINDOWS> _minima;
+  std::array<float, SIZE> _current;
+  std::array<float, SIZE> _window_min;
+  std::array<float, SIZE> _floor;
+  std::array<float, SIZE> _above;
+};
@@ -0,0 +1,82 @@
+// Copyright: 2020, Diez B. Roggisch, Berlin, all rights reserved
+#pragma once
+
+#include <stdint.h>
+#include <array>
+#include <utility>
+
+// Masks for the spectra, so known mechanical resonances
+// of a grinder don't clutter the display and the stream.
+//
+// A mask is applied by the postprocessing of the engines,
+// which write MASKED_DB instead of the power of the masked
+// bins. The tables are generated at compile time per
+// transform size, so this costs one table lookup per bin.
+
+// The value of masked bins, below anything
+// a real spectrum contains.
+const float MASKED_DB = -200.0;
+
+// The MPU6050 FIFO runs at 1kHz, the notches are
+// mapped to bins assuming this.
+const int NOMINAL_SAMPLERATE = 1000;
+
+// The grinder models, with their resonances as
+// [low, high] frequency ranges in Hz.
+struct NoGrinderModel
+{
+  static constexpr std::array<std::pair<float, float>, 0> NOTCHES = {};
+};
+
+// The grinder the prototype was built for, the
+// same bands scripts/show-fft.py removes.
+struct PrototypeGrinderModel
+{
+  static constexpr std::array<std::pair<float, float>, 3> NOTCHES = {{
+      { 247.1, 252.9 },
+      { 278.3, 283.2 },
+      { 453.1, 460.9 },
+    }};
+};
+
+struct NoMask
+{
+  static constexpr bool ENABLED = false;
+
+  template<int N>
+  static constexpr std::array<uint8_t, N / 2> values = {};
+};
+
+// Masks the bins of a N-point transform at SAMPLERATE
+// decimated by DECIMATION which overlap a notch of the
+// Model. The rate is kept as the ratio, so it isn't
+// truncated for factors not dividing SAMPLERATE.
+template<int SAMPLERATE, int DECIMATION, typename Model>
+struct NotchMask
+{
+  static constexpr bool ENABLED = Model::NOTCHES.size() > 0;
+
+  template<int N>
+  static constexpr std::array<uint8_t, N / 2> make()
+  {
+    std::array<uint8_t, N / 2> res = {};
+    const double spacing = double(SAMPLERATE) / (double(DECIMATION) * N);
+    for(int k=0; k < N / 2; ++k)
+    {
+      // the bin covers +/- half a spacing
+      const auto low = (k - 0.5) * spacing;
+      const auto high = (k + 0.5) * spacing;
+      for(const auto& notch : Model::NOTCHES)
+      {
+        if(high > notch.first && low < notch.second)
+        {
+          res[k] = 1;
+        }
+      }
+    }
+    return res;
+  }
+
+  template<int N>
+  static constexpr std::array<uint8_t, N / 2> values = make<N>();
+};
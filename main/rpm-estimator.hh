@@ -0,0 +1,148 @@
+// Copyright: 2020, Diez B. Roggisch, Berlin, all rights reserved
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <algorithm>
+
+// Estimates the motor speed from a postprocessed spectrum.
+//
+// The fundamental is found by a harmonic product spectrum:
+// for each candidate bin k the powers at k, 2k, ... HARMONICS * k
+// are multiplied, which on dB values is a sum. Only the true
+// fundamental gets contributions from all harmonics. As each
+// candidate reads HARMONICS bins below bins / HARMONICS, this is
+// O(bins) per frame, and no memory is needed besides the
+// tracker state.
+//
+// The peak is refined by a parabola through its neighbours, and
+// then tracked: small changes are smoothed, while a jump has to
+// be confirmed by a few frames in a row before it is accepted.
+template<int HARMONICS=3>
+class RPMEstimator
+{
+  // bins further below the peak are clamped, so
+  // masked or empty bins don't veto a candidate
+  static constexpr float DYNAMIC_RANGE = 60.0;
+  // how far the peak of the product must be above
+  // its mean, per harmonic, to count as a detection
+  static constexpr float MIN_SALIENCE = 6.0;
+  // relative change considered a jump
+  static constexpr float MAX_DRIFT = 0.1;
+  static constexpr int JUMP_CONFIRMATIONS = 3;
+  // frames without detection until we give up
+  static constexpr int HOLD_FRAMES = 16;
+  static constexpr float SMOOTHING = 0.3;
+
+public:
+  // Without a bin spacing, the
+  // frequency is in bins.
+  RPMEstimator(float bin_spacing=1.0)
+    : _bin_spacing(bin_spacing)
+  {
+  }
+
+  // Estimates from the dB values [begin, end), which are
+  // the bins starting at first of the spectrum. Returns
+  // if there is a valid estimate.
+  template<typename T>
+  bool update(T begin, T end, size_t first)
+  {
+    const size_t last = first + (end - begin);
+    // the bins of the highest harmonic of a
+    // candidate and its upper neighbour must exist
+    const auto lowest = std::max(first, size_t(1)) + 1;
+    const auto highest = last > 0 ? (last - 1) / HARMONICS : 0;
+    if(lowest >= highest)
+    {
+      return _valid;
+    }
+
+    const auto floor = *std::max_element(begin, end) - DYNAMIC_RANGE;
+    const auto product = [&](size_t k)
+                         {
+                           float res = 0.0;
+                           for(size_t h=1; h <= HARMONICS; ++h)
+                           {
+                             res += std::max(float(begin[k * h - first]), floor);
+                           }
+                           return res;
+                         };
+
+    size_t peak = lowest;
+    float peak_value = product(lowest);
+    float sum = 0.0;
+    for(auto k=lowest; k < highest; ++k)
+    {
+      const auto value = product(k);
+      sum += value;
+      if(value > peak_value)
+      {
+        peak = k;
+        peak_value = value;
+      }
+    }
+    const auto mean = sum / (highest - lowest);
+    if((peak_value - mean) / HARMONICS < MIN_SALIENCE)
+    {
+      if(++_misses > HOLD_FRAMES)
+      {
+        _valid = false;
+      }
+      return _valid;
+    }
+    _misses = 0;
+
+    const auto a = product(peak - 1);
+    const auto c = product(peak + 1);
+    const auto curvature = a - 2 * peak_value + c;
+    const auto offset = curvature < 0 ? 0.5f * (a - c) / curvature : 0.0f;
+    track((peak + offset) * _bin_spacing);
+    return _valid;
+  }
+
+  void set_bin_spacing(float bin_spacing)
+  {
+    _bin_spacing = bin_spacing;
+    _valid = false;
+  }
+
+  bool valid() const
+  {
+    return _valid;
+  }
+
+  // The fundamental in Hz
+  float frequency() const
+  {
+    return _frequency;
+  }
+
+  float rpm() const
+  {
+    return _frequency * 60;
+  }
+
+private:
+  void track(float frequency)
+  {
+    if(_valid && fabsf(frequency - _frequency) <= MAX_DRIFT * _frequency)
+    {
+      _frequency += SMOOTHING * (frequency - _frequency);
+      _jumps = 0;
+      return;
+    }
+    if(!_valid || ++_jumps >= JUMP_CONFIRMATIONS)
+    {
+      _frequency = frequency;
+      _valid = true;
+      _jumps = 0;
+    }
+  }
+
+  float _bin_spacing;
+  float _frequency = 0.0;
+  bool _valid = false;
+  int _misses = 0;
+  int _jumps = 0;
+};
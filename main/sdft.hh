@@ -0,0 +1,182 @@
+// Copyright: 2020, Diez B. Roggisch, Berlin, all rights reserved
+#pragma once
+#include "fft.hh"
+
+#include <math.h>
+#include <assert.h>
+#include <array>
+#include <algorithm>
+
+// A recursive sliding DFT that only tracks the bins
+// [FIRST, LAST) of a N-point real-valued transform.
+//
+// Each fed sample updates the tracked bins in O(1) per bin:
+//
+//   X_k <- (X_k + x_new - x_old) * e^(2 pi i k / N)
+//
+// The Hann window is applied in the frequency domain
+// by convolving neighbouring bins, so we track one
+// additional bin on each side of the range. Like the
+// window tables of the FFT it is amplitude corrected.
+//
+// The recursion accumulates rounding errors, so on each
+// hop one bin is recomputed directly from the sample
+// history. Every bin thus gets resynchronised at least
+// every (LAST - FIRST + 2) hops.
+//
+// The interface mirrors FFT<N, OVERLAP, RealInput>,
+// so this can be used as drop-in replacement.
+template<int N, int OVERLAP, int FIRST, int LAST, typename Mask=NoMask>
+class SlidingDFT
+{
+  static_assert(FIRST >= 1 && FIRST < LAST && LAST <= N / 2, "invalid bin range");
+
+  static constexpr int LOWEST = FIRST - 1;
+  static constexpr int TRACKED = LAST - FIRST + 2;
+
+public:
+  int n = N;
+
+  SlidingDFT()
+  {
+    _history.fill(0.0);
+    _bins.fill(0.0);
+    _fft.fill(0.0);
+  }
+
+  bool feed(float value)
+  {
+    const auto& twiddle = detail::TwiddleTable<N, N>::values;
+    const auto delta = value - _history[_history_head];
+    _history[_history_head] = value;
+    _history_head = (_history_head + 1) % N;
+
+    for(size_t i=0; i < TRACKED; ++i)
+    {
+      const auto k = LOWEST + i;
+      // rotate by the conjugate twiddle, e^(2 pi i k / N)
+      detail::complex_multiply(
+        _bins[i * 2] + delta, _bins[i * 2 + 1],
+        twiddle[k * 2], -twiddle[k * 2 + 1],
+        _bins[i * 2], _bins[i * 2 + 1]
+        );
+    }
+    return ++_pending >= OVERLAP;
+  }
+
+  void compute()
+  {
+    update_input();
+    transform();
+  }
+
+  // The samples already went into the bins when
+  // they were fed, so there is nothing left to do
+  // but to account for the hop.
+  void update_input()
+  {
+    _pending -= OVERLAP;
+  }
+
+  void transform()
+  {
+    resynchronise(_resync_bin);
+    _resync_bin = (_resync_bin + 1) % TRACKED;
+
+    // Hann window as convolution with [-1/4, 1/2, -1/4],
+    // times the amplitude correction of 2
+    for(size_t k=FIRST; k < LAST; ++k)
+    {
+      const auto i = k - LOWEST;
+      for(size_t j=0; j < 2; ++j)
+      {
+        _fft[k * 2 + j] = _bins[i * 2 + j]
+          - 0.5f * (_bins[(i - 1) * 2 + j] + _bins[(i + 1) * 2 + j]);
+      }
+    }
+  }
+
+  void postprocess(size_t first, size_t last)
+  {
+    assert(first >= FIRST && last <= LAST);
+    const auto& mask = Mask::template values<N>;
+    for(size_t k=first; k < last; ++k)
+    {
+      if constexpr(Mask::ENABLED)
+      {
+        if(mask[k])
+        {
+          _fft[k] = MASKED_DB;
+          continue;
+        }
+      }
+      _fft[k] = detail::power_db(_fft[k * 2], _fft[k * 2 + 1], detail::ilog2(N));
+    }
+  }
+
+  // Like the FFT this yields all N/2 bins, the untracked
+  // ones are reported as masked.
+  void postprocess()
+  {
+    postprocess(FIRST, LAST);
+    std::fill(_fft.begin(), _fft.begin() + FIRST, MASKED_DB);
+    std::fill(_fft.begin() + LAST, _fft.begin() + N / 2, MASKED_DB);
+  }
+
+  size_t size() const
+  {
+    return N;
+  }
+
+  size_t bins() const
+  {
+    return N / 2;
+  }
+
+  template<typename T>
+  size_t copy_fft(T& container)
+  {
+    container.resize(_fft.size());
+    std::copy(_fft.begin(), _fft.end(), container.begin());
+    return _fft.size();
+  }
+
+  const std::array<float, N>& fft() const
+  {
+    return _fft;
+  }
+
+private:
+  void resynchronise(size_t i)
+  {
+    const auto& twiddle = detail::TwiddleTable<N, N>::values;
+    const auto k = LOWEST + i;
+    float re = 0.0, im = 0.0;
+    // the history head points at the oldest sample
+    size_t m = 0;
+    for(size_t h=_history_head; h < N; ++h, ++m)
+    {
+      const auto t = (k * m) % N;
+      re += _history[h] * twiddle[t * 2];
+      im += _history[h] * twiddle[t * 2 + 1];
+    }
+    for(size_t h=0; h < _history_head; ++h, ++m)
+    {
+      const auto t = (k * m) % N;
+      re += _history[h] * twiddle[t * 2];
+      im += _history[h] * twiddle[t * 2 + 1];
+    }
+    _bins[i * 2] = re;
+    _bins[i * 2 + 1] = im;
+  }
+
+  std::array<float, N> _history;
+  size_t _history_head = 0;
+  std::array<float, TRACKED * 2> _bins;
+  // Same layout as the FFT: complex bins, and after
+  // postprocessing the dB values from the beginning
+  std::array<float, N> _fft;
+
+  int _pending = 0;
+  size_t _resync_bin = 0;
+};
@@ -0,0 +1,109 @@
+// Copyright: 2020, Diez B. Roggisch, Berlin, all rights reserved
+#pragma once
+#include "fft.hh"
+
+#include <array>
+#include <algorithm>
+
+// Averages consecutive postprocessed spectra, so
+// the noise of single frames doesn't make the waterfall
+// flicker.
+//
+// The averaging happens on the power, not the dB values,
+// in one accumulator of SIZE bins, so the memory footprint
+// is fixed regardless of the number of averaged frames.
+//
+// EXPONENTIAL keeps a running average with a time constant
+// of `frames` frames and has a result after each frame.
+// WELCH sums up `frames` frames and then yields their mean,
+// the hops of the FFT being the overlapping segments.
+template<int SIZE>
+class SpectralAverager
+{
+public:
+  enum mode_e
+  {
+    EXPONENTIAL,
+    WELCH
+  };
+
+  SpectralAverager(mode_e mode, int frames)
+    : _mode(mode)
+    , _frames(std::max(frames, 1))
+    , _alpha(1.0f / _frames)
+  {
+    _power.fill(0.0);
+  }
+
+  // Adds the dB values [begin, end) of one frame. Returns
+  // true if there is a new average, which result() then
+  // yields with the same size as the frame.
+  template<typename T>
+  bool add(T begin, T end)
+  {
+    const auto size = std::min(size_t(end - begin), size_t(SIZE));
+    if(size != _size)
+    {
+      reset();
+      _size = size;
+    }
+    const auto first = _count == 0;
+    ++_count;
+    for(size_t i=0; i < size; ++i, ++begin)
+    {
+      const auto power = detail::fast_exp2(*begin / detail::DB_PER_OCTAVE);
+      if(first)
+      {
+        _power[i] = power;
+      }
+      else if(_mode == EXPONENTIAL)
+      {
+        _power[i] += _alpha * (power - _power[i]);
+      }
+      else
+      {
+        _power[i] += power;
+      }
+    }
+    if(_mode == EXPONENTIAL)
+    {
+      _scale = 1.0;
+      return true;
+    }
+    if(_count < _frames)
+    {
+      return false;
+    }
+    _scale = _alpha;
+    _count = 0;
+    return true;
+  }
+
+  // Writes the dB values of the last average to out.
+  void result(float* out) const
+  {
+    for(size_t i=0; i < _size; ++i)
+    {
+      out[i] = detail::DB_PER_OCTAVE * detail::fast_log2(_power[i] * _scale);
+    }
+  }
+
+  void reset()
+  {
+    _count = 0;
+  }
+
+  size_t size() const
+  {
+    return _size;
+  }
+
+private:
+  mode_e _mode;
+  int _frames;
+  float _alpha;
+  int _count = 0;
+  size_t _size = 0;
+  float _scale = 1.0;
+  std::array<float, SIZE> _power;
+};
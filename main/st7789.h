@@ -27,6 +27,9 @@
 #define ST7789_RAMWR                                0x2C
 #define ST7789_DISPOFF                              0x28
 #define ST7789_DISPON                               0x29
+#define ST7789_VSCRDEF                              0x33      // Vertical scrolling definition
+#define ST7789_VSCSAD                               0x37      // Vertical scroll start address
+#define ST7789_GRAM_LINES                           320
 #define TFT_MAD_COLOR_ORDER                         TFT_MAD_RGB
 #define TFT_MAD_MY                                  0x80
 #define TFT_MAD_MX                                  0x40
@@ -0,0 +1,63 @@
+// Copyright: 2020, Diez B. Roggisch, Berlin, all rights reserved
+#pragma once
+#include "spectral-averager.hh"
+#include "frame-pool.hh"
+
+// Publishes the short time spectra of an engine for any
+// number of consumers.
+//
+// The postprocessed bins of each transformed hop are
+// averaged, and every new average is written once into a
+// frame of a FramePool. Consumers hold on to the frame as
+// long as they need it, instead of each making its own
+// copy of the engine's output, which the next hop
+// overwrites.
+template<int SIZE>
+class STFTProducer
+{
+public:
+  using Averager = SpectralAverager<SIZE>;
+
+  STFTProducer(typename Averager::mode_e mode, int frames, size_t pool_size)
+    : _averager(mode, frames)
+    , _pool(SIZE, pool_size)
+  {
+  }
+
+  // Publishes the dB values [begin, end), which start at
+  // first_bin of the spectrum. Returns an empty reference
+  // if there is no new average yet, or if all frames are
+  // still held by consumers.
+  template<typename T>
+  FrameRef publish(T begin, T end, size_t first_bin)
+  {
+    if(!_averager.add(begin, end))
+    {
+      return FrameRef();
+    }
+    auto writer = _pool.acquire();
+    if(!writer)
+    {
+      return FrameRef();
+    }
+    _averager.result(writer.data());
+    writer.set_size(_averager.size(), first_bin);
+    return _pool.publish(std::move(writer));
+  }
+
+  // Starts a new average, for when the spectra
+  // we get change their meaning.
+  void reset()
+  {
+    _averager.reset();
+  }
+
+  const FramePool& pool() const
+  {
+    return _pool;
+  }
+
+private:
+  Averager _averager;
+  FramePool _pool;
+};
@@ -1,8 +1,10 @@
 #include "streamer.hh"
 #include "wifi.hh"
+#include "notch-mask.hh"
 
 #include <esp_log.h>
 #include <mdns.h>
+#include <stdlib.h>
 
 namespace {
 
@@ -16,6 +18,24 @@ void setup_mdns()
   mdns_service_add(NULL, "_http", "_tcp", 80, NULL, 0);
 }
 
+// Calls callback with the [first, last) ranges
+// of the values which aren't masked.
+template<typename F>
+void unmasked_ranges(const float* values, size_t size, F callback)
+{
+  size_t i = 0;
+  while(i < size)
+  {
+    for(; i < size && values[i] <= MASKED_DB; ++i);
+    const auto first = i;
+    for(; i < size && values[i] > MASKED_DB; ++i);
+    if(first < i)
+    {
+      callback(first, i);
+    }
+  }
+}
+
 } // end ns anonymous
 
 DataStreamer::DataStreamer(const std::string&, int)
@@ -78,12 +98,95 @@ esp_err_t DataStreamer::get_raw_handler(httpd_req_t *req)
   return ESP_OK;
 }
 
+void DataStreamer::deliver_frame(const FrameRef& frame)
+{
+  std::lock_guard<std::mutex> guard(_frame_mutex);
+  _frame = frame;
+}
+
 esp_err_t DataStreamer::get_fft_handler(httpd_req_t *req)
 {
-  swap(_fft_in_flight, _fft_streaming);
-  httpd_resp_send(req, reinterpret_cast<const char*>(_fft_streaming.data()), _fft_streaming.size() * sizeof(decltype(_fft_streaming)::value_type));
-  //ESP_LOGI(TAG, "fft size: %i", _fft_streaming.size());
-  _fft_streaming.clear();
+  // each frame is only sent once, and goes
+  // back to the pool when we are done
+  FrameRef frame;
+  {
+    std::lock_guard<std::mutex> guard(_frame_mutex);
+    std::swap(frame, _frame);
+  }
+  if(frame)
+  {
+    // the masked bins aren't transferred, the headers
+    // give the frame size and the ranges we send
+    const auto frame_size = std::to_string(frame.size());
+    std::string ranges;
+    unmasked_ranges(
+      frame.begin(), frame.size(),
+      [&](size_t first, size_t last)
+      {
+        ranges += (ranges.empty() ? "" : ",") + std::to_string(first) + "-" + std::to_string(last);
+      });
+    httpd_resp_set_hdr(req, "X-Frame-Size", frame_size.c_str());
+    httpd_resp_set_hdr(req, "X-Bins", ranges.c_str());
+    unmasked_ranges(
+      frame.begin(), frame.size(),
+      [&](size_t first, size_t last)
+      {
+        httpd_resp_send_chunk(
+          req, reinterpret_cast<const char*>(frame.begin() + first), (last - first) * sizeof(float));
+      });
+    httpd_resp_send_chunk(req, nullptr, 0);
+  }
+  else
+  {
+    httpd_resp_send(req, nullptr, 0);
+  }
+  return ESP_OK;
+}
+
+void DataStreamer::deliver_rpm(float rpm)
+{
+  _rpm = rpm;
+}
+
+esp_err_t DataStreamer::get_rpm_handler(httpd_req_t *req)
+{
+  const float rpm = _rpm;
+  httpd_resp_send(req, reinterpret_cast<const char*>(&rpm), sizeof(rpm));
+  return ESP_OK;
+}
+
+void DataStreamer::deliver_anomaly(float score)
+{
+  _anomaly = score;
+}
+
+esp_err_t DataStreamer::get_anomaly_handler(httpd_req_t *req)
+{
+  const float score = _anomaly;
+  httpd_resp_send(req, reinterpret_cast<const char*>(&score), sizeof(score));
+  return ESP_OK;
+}
+
+int DataStreamer::take_fft_size_request()
+{
+  return _fft_size_request.exchange(0);
+}
+
+esp_err_t DataStreamer::get_fft_size_handler(httpd_req_t *req)
+{
+  // the switch itself happens on the main task,
+  // between two hops
+  char query[32], value[8];
+  if(httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK
+     && httpd_query_key_value(query, "n", value, sizeof(value)) == ESP_OK)
+  {
+    _fft_size_request = atoi(value);
+    httpd_resp_sendstr(req, "ok");
+  }
+  else
+  {
+    httpd_resp_sendstr(req, "usage: /fft-size?n=<size>");
+  }
   return ESP_OK;
 }
 
@@ -122,6 +225,42 @@ httpd_handle_t DataStreamer::start_webserver(void)
       };
       httpd_register_uri_handler(server, &fft_get);
 
+      _rpm_get_callback = [this](httpd_req_t* req)
+                          {
+                            return get_rpm_handler(req);
+                          };
+      httpd_uri_t rpm_get = {
+        .uri      = "/rpm",
+        .method   = HTTP_GET,
+        .handler  = s_http_request_forwarder,
+        .user_ctx = &_rpm_get_callback
+      };
+      httpd_register_uri_handler(server, &rpm_get);
+
+      _anomaly_get_callback = [this](httpd_req_t* req)
+                              {
+                                return get_anomaly_handler(req);
+                              };
+      httpd_uri_t anomaly_get = {
+        .uri      = "/anomaly",
+        .method   = HTTP_GET,
+        .handler  = s_http_request_forwarder,
+        .user_ctx = &_anomaly_get_callback
+      };
+      httpd_register_uri_handler(server, &anomaly_get);
+
+      _fft_size_get_callback = [this](httpd_req_t* req)
+                               {
+                                 return get_fft_size_handler(req);
+                               };
+      httpd_uri_t fft_size_get = {
+        .uri      = "/fft-size",
+        .method   = HTTP_GET,
+        .handler  = s_http_request_forwarder,
+        .user_ctx = &_fft_size_get_callback
+      };
+      httpd_register_uri_handler(server, &fft_size_get);
+
     }
     /* If server failed to start, handle will be NULL */
     return server;
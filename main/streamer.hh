@@ -5,6 +5,7 @@
 #endif
 
 #pragma once
+#include "frame-pool.hh"
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
@@ -14,6 +15,7 @@
 #include <vector>
 #include <functional>
 #include <mutex>
+#include <atomic>
 
 #define STREAMER_TASK_STACK_SIZE 2000
 
@@ -35,12 +37,16 @@ public:
 
   void feed(float value);
 
-  template<typename FFT>
-  void deliver_fft(FFT& fft)
-  {
-    fft->copy_fft(_fft_incoming);
-    swap(_fft_incoming, _fft_in_flight);
-  }
+  // Holds on to the frame until it is fetched
+  // or replaced by the next one.
+  void deliver_frame(const FrameRef& frame);
+
+  void deliver_rpm(float rpm);
+  void deliver_anomaly(float score);
+
+  // The FFT size requested by /fft-size?n=<size>,
+  // 0 if there was no request since the last call.
+  int take_fft_size_request();
 
 private:
   static void s_run(void*);
@@ -50,13 +56,9 @@ private:
 
   esp_err_t get_raw_handler(httpd_req_t *req);
   esp_err_t get_fft_handler(httpd_req_t *req);
-
-  template<typename C>
-  void swap(C& left, C& right)
-  {
-    std::lock_guard<std::mutex> guard(_fft_mutex);
-    std::swap(left, right);
-  }
+  esp_err_t get_rpm_handler(httpd_req_t *req);
+  esp_err_t get_anomaly_handler(httpd_req_t *req);
+  esp_err_t get_fft_size_handler(httpd_req_t *req);
 
 
   TaskHandle_t _task_handle;
@@ -68,12 +70,17 @@ private:
 
   std::vector<float> _raw_buffer;
 
-  std::vector<float> _fft_incoming;
-  std::vector<float> _fft_in_flight;
-  std::vector<float> _fft_streaming;
-  std::mutex _fft_mutex;
+  FrameRef _frame;
+  std::mutex _frame_mutex;
+
+  std::atomic<float> _rpm = { 0.0 };
+  std::atomic<float> _anomaly = { 0.0 };
+  std::atomic<int> _fft_size_request = { 0 };
 
   http_callback_t _raw_get_callback;
   http_callback_t _fft_get_callback;
+  http_callback_t _rpm_get_callback;
+  http_callback_t _anomaly_get_callback;
+  http_callback_t _fft_size_get_callback;
 
 };
@@ -0,0 +1,153 @@
+// Copyright: 2020, Diez B. Roggisch, Berlin, all rights reserved
+#pragma once
+#include "fft.hh"
+#include "decimator.hh"
+
+#include <math.h>
+#include <array>
+#include <algorithm>
+
+// A zoom FFT: the real input is mixed down by a
+// configurable centre frequency, lowpass filtered and
+// decimated by D as complex baseband, and then
+// transformed. The N bins then span samplerate / D
+// around the centre, giving a bin spacing of
+// samplerate / (D * N).
+//
+// Only the bins within the passband of the decimator
+// are kept, the outer ones sit in its transition band
+// and carry aliases. After postprocessing, fft() holds
+// their dB values in ascending frequency order, centred
+// on the centre frequency, so it can go straight into
+// FFTDisplay.
+template<int N, int OVERLAP, int D, int TAPS, typename Window=HannWindow>
+class ZoomFFT
+{
+  // renormalise the oscillator this often to
+  // keep its amplitude at 1
+  static const int NCO_RENORMALISE = 256;
+  // the bins dropped on each side
+  static constexpr int EDGE = N / 2 - int(N / 2 * detail::DecimationTaps<D, TAPS>::PASSBAND);
+  static constexpr int BINS = N - 2 * EDGE;
+
+public:
+  int n = N;
+
+  ZoomFFT(float samplerate, float centre)
+    : _samplerate(samplerate)
+  {
+    _db.fill(0.0);
+    set_centre(centre);
+  }
+
+  void set_centre(float centre)
+  {
+    _centre = centre;
+    const auto w = 2 * float(M_PI) * centre / _samplerate;
+    _rotation_re = cosf(w);
+    _rotation_im = -sinf(w);
+  }
+
+  float centre() const
+  {
+    return _centre;
+  }
+
+  float bin_spacing() const
+  {
+    return _samplerate / (D * N);
+  }
+
+  bool feed(float value)
+  {
+    // mix down by e^(-i w t), the oscillator is a rotating phasor
+    const auto re = value * _nco_re;
+    const auto im = value * _nco_im;
+    detail::complex_multiply(
+      _nco_re, _nco_im, _rotation_re, _rotation_im, _nco_re, _nco_im);
+    if(++_nco_count == NCO_RENORMALISE)
+    {
+      _nco_count = 0;
+      const auto scale = 1.0f / sqrtf(_nco_re * _nco_re + _nco_im * _nco_im);
+      _nco_re *= scale;
+      _nco_im *= scale;
+    }
+
+    float dre = 0.0, dim = 0.0;
+    // both decimators run in lockstep
+    const auto ready = _decimate_re.feed(re, dre);
+    _decimate_im.feed(im, dim);
+    if(!ready)
+    {
+      return false;
+    }
+    return _fft.feed(dre, dim);
+  }
+
+  void update_input()
+  {
+    _fft.update_input();
+  }
+
+  void transform()
+  {
+    _fft.transform();
+  }
+
+  void compute()
+  {
+    update_input();
+    transform();
+  }
+
+  // Turns the bins [first, last), in ascending
+  // frequency order, into their power in dB.
+  void postprocess(size_t first, size_t last)
+  {
+    const auto& spectrum = _fft.fft();
+    for(size_t i=first; i < last; ++i)
+    {
+      const auto k = (i + EDGE + N / 2) % N;
+      _db[i] = detail::power_db(spectrum[k * 2], spectrum[k * 2 + 1], detail::ilog2(N));
+    }
+  }
+
+  void postprocess()
+  {
+    postprocess(0, bins());
+  }
+
+  size_t size() const
+  {
+    return N;
+  }
+
+  size_t bins() const
+  {
+    return BINS;
+  }
+
+  template<typename T>
+  size_t copy_fft(T& container)
+  {
+    container.resize(_db.size());
+    std::copy(_db.begin(), _db.end(), container.begin());
+    return _db.size();
+  }
+
+  const std::array<float, BINS>& fft() const
+  {
+    return _db;
+  }
+
+private:
+  float _samplerate;
+  float _centre;
+  float _rotation_re, _rotation_im;
+  float _nco_re = 1.0, _nco_im = 0.0;
+  int _nco_count = 0;
+
+  Decimator<D, TAPS> _decimate_re, _decimate_im;
+  FFT<N, OVERLAP, IQInput, Window> _fft;
+  std::array<float, BINS> _db;
+};
@@ -1,19 +1,39 @@
 # -*- coding: utf-8 -*-
 # Copyright: 2020, Diez B. Roggisch, Berlin . All rights reserved.
+from collections import Counter
+
 import numpy as np
 
 
-def load_fft_data(fname):
+def load_fft_data(fname, axes=1, axis=0):
+    """
+    Loads the spectra streamed from /fft.
+
+    Each frame holds the dB of the power of the bins from
+    bin 0 up to N/2, for multi-axis FFTs the axes follow
+    each other. Bins masked by the firmware are nan.
+    Frames are either comma separated lines as
+    written by fetch-gyro-data-via-http.py, or one value per
+    line terminated by "--".
+
+    Only the frames of the most common size are kept, as the
+    FFT size can be switched while recording.
+    """
     ffts = []
     with open(fname) as inf:
         current_fft = []
         for line in inf:
             line = line.strip()
             if line == "--":
-                ffts.append(current_fft[:512])
+                ffts.append(current_fft)
                 current_fft = []
-            else:
+            elif "," in line:
+                ffts.append([float(v) for v in line.split(",")])
+            elif line:
                 current_fft.append(float(line))
 
-    ffts = np.array(ffts)
-    return ffts
+    ffts = [fft for fft in ffts if fft]
+    size, _ = Counter(len(fft) for fft in ffts).most_common(1)[0]
+    ffts = np.array([fft for fft in ffts if len(fft) == size])
+    bins = size // axes
+    return ffts[:, axis * bins:(axis + 1) * bins]
@@ -1,6 +1,7 @@
 # -*- coding: utf-8 -*-
 # Copyright: 2020, Diez B. Roggisch, Berlin . All rights reserved.
 import sys
+import math
 import time
 import http.client
 import struct
@@ -15,13 +16,34 @@ def read_floats(conn, path):
     return struct.unpack("f" * (len(data) // 4), data)
 
 
+def read_fft(conn):
+    """
+    The masked bins of a frame aren't transferred, they
+    are filled in as nan.
+    """
+    conn.request("GET", "/fft")
+    response = conn.getresponse()
+    data = response.read()
+    size = int(response.getheader("X-Frame-Size", "0"))
+    ranges = response.getheader("X-Bins", "")
+    response.close()
+    values = struct.unpack("f" * (len(data) // 4), data)
+    frame = [math.nan] * size
+    pos = 0
+    for bins in filter(None, ranges.split(",")):
+        first, last = (int(v) for v in bins.split("-"))
+        frame[first:last] = values[pos:pos + last - first]
+        pos += last - first
+    return frame
+
+
 def main():
     conn = http.client.HTTPConnection("coffee-grinder-clock.local")
     print("connected")
     with open(sys.argv[1], "w") as rawf, open(sys.argv[2], "w") as fftf:
         while True:
             raw_data = read_floats(conn, "/")
-            fft_data = read_floats(conn, "/fft")
+            fft_data = read_fft(conn)
             print("raw", len(raw_data), "fft: ", len(fft_data))
             rawf.write("\n".join(str(f) for f in raw_data))
             rawf.write("\n")
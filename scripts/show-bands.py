@@ -19,14 +19,13 @@ def main():
     parser = argparse.ArgumentParser()
     parser.add_argument("fft_data")
     parser.add_argument("bands", nargs="+")
-    parser.add_argument("--db", action="store_true")
+    parser.add_argument("--axes", type=int, default=1)
+    parser.add_argument("--axis", type=int, default=0)
     parser.add_argument("--start", type=int)
     parser.add_argument("--stop", type=int)
     opts = parser.parse_args()
-    ffts = load_fft_data(opts.fft_data)
-
-    if opts.db:
-        ffts = 20 * np.log10(ffts)
+    # the streamed spectra are already in dB
+    ffts = load_fft_data(opts.fft_data, opts.axes, opts.axis)
 
     if opts.start is not None or opts.stop is not None:
         ffts = ffts[slice(opts.start, opts.stop), :]
@@ -1,39 +1,53 @@
 # -*- coding: utf-8 -*-
 # Copyright: 2020, Diez B. Roggisch, Berlin . All rights reserved.
-import sys
+import argparse
 
 import numpy as np
 import matplotlib.pyplot as plt
 
 from common import load_fft_data
 
-N = 1024
-T = 1.0 / 1000.0
+# The nominal MPU6050 rate, divided by
+# COFFEE_CLOCK_DECIMATION ahead of the FFT
+SAMPLERATE = 1000.0
 
+# lowpass and resonances of the prototype grinder, in Hz,
+# as in main/notch-mask.hh
+LOWPASS = 19.5
 NOTCHES = [
-    (253, 259),
-    (285, 290),
-    (464, 472),
+    (247.1, 252.9),
+    (278.3, 283.2),
+    (453.1, 460.9),
 ]
 
 START = 250
 END = 2010
-THRESHOLD = -170.0
+# dB of the power, 10 * log10(|X / N|^2)
+THRESHOLD = -85.0
 
 
 def main():
-    ffts = load_fft_data(sys.argv[1])
+    parser = argparse.ArgumentParser()
+    parser.add_argument("fft_data")
+    parser.add_argument("--decimation", type=int, default=1)
+    parser.add_argument("--axes", type=int, default=1)
+    parser.add_argument("--axis", type=int, default=0)
+    opts = parser.parse_args()
+
+    ffts = load_fft_data(opts.fft_data, opts.axes, opts.axis)
+    # the frames hold bins 0 to N/2
+    spacing = SAMPLERATE / opts.decimation / (ffts.shape[1] * 2)
     # crop to relevant range
     ffts = ffts[START:END, :]
     # lowpass
-    ffts[:, :20] = 0.0
+    ffts[:, :int(LOWPASS / spacing) + 1] = THRESHOLD
     for low, high in NOTCHES:
-        ffts[:, low:high] = 0.0
-
-    ffts = 20 * np.log10(ffts)
+        ffts[:, int(round(low / spacing)):int(round(high / spacing)) + 1] = THRESHOLD
 
+    # the bins masked by the firmware aren't streamed
+    ffts[np.isnan(ffts)] = THRESHOLD
     if THRESHOLD is not None:
-        ffts[ffts < THRESHOLD] = 0.0
+        ffts[ffts < THRESHOLD] = THRESHOLD
 
     ffts = ffts.T
     plt.imshow(
@@ -41,7 +55,8 @@ def main():
         origin='lower',
         cmap='jet',
         interpolation='nearest',
-        aspect='auto'
+        aspect='auto',
+        extent=(START, START + ffts.shape[1], 0, ffts.shape[0] * spacing),
     )
     plt.grid()
     plt.show()